@@ -0,0 +1,158 @@
+//
+// DHCPLeaseClass.cpp
+//
+// Contains the methods for the DHCPLeaseClass, which configures the ethernet
+// shield from a cached lease or by DHCP.
+//
+// V1.1.2 of the Ethernet library only does DHCP as a blocking call, which 
+// also resets the W5100 (closing all of its sockets).  We therefore only try 
+// DHCP straight after a poll, with short timeouts, and put the previous 
+// settings back if it fails.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//
+//------------------------------------------------------------------------------
+#include "DHCPLeaseClass.h"
+
+//
+//-----------------------------------------------------------------------------
+// Constructor
+DHCPLeaseClass::DHCPLeaseClass() {
+  _fromDHCP = false;
+  _confirm = false;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Configure the ethernet shield with the passed MAC address and lease.  If the
+// passed lease was cached, it is used straight away and confirmed with the DHCP
+// server on the first call to maintain().  Otherwise we have nothing to poll
+// with, so we wait for DHCP here and only fall back to the passed lease (the
+// hard coded settings) if the DHCP server doesn't answer.
+//
+// Returns 0 if a DHCP lease is in use, otherwise -1
+//
+int DHCPLeaseClass::begin(uint8_t *mac, struct lease_t *lease, bool cached) {
+  _mac = mac;
+  _lease = *lease;
+
+  if (cached) {
+    applyStatic();
+    _confirm = true;
+    _attemptMillis = millis();
+    return -1;
+  };
+
+  _attemptMillis = millis();
+  if (Ethernet.begin(_mac, DHCP_TIMEOUT, DHCP_RESPONSE_TIMEOUT) == 1) {
+    _fromDHCP = true;
+    readSettings();
+    return 0;
+  };
+
+  applyStatic();
+  return -1;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Ask for the lease to be confirmed with the DHCP server on the next call to 
+// maintain().  Called once the modem is back online after a power cycle, since
+// it may have lost its DHCP table
+//
+void DHCPLeaseClass::confirm() {
+  _confirm = true;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Look after the lease.  Call this straight after a poll, so that any time 
+// spent waiting on the DHCP server comes out of the gap before the next poll.
+//
+// Returns LEASE_CHANGED if the ethernet shield has been reconfigured, in which
+// case the caller must reopen its sockets and cache the lease
+//
+int DHCPLeaseClass::maintain() {
+  struct lease_t previous = _lease;
+  uint8_t result;
+
+  // Once DHCP has answered, the library renews and rebinds the lease itself when it is due
+  if (_fromDHCP && !_confirm) {
+    result = Ethernet.maintain();
+    if ((result == 2) || (result == 4)) {  // DHCP_CHECK_RENEW_OK, DHCP_CHECK_REBIND_OK
+      readSettings();
+      if (memcmp(&previous, &_lease, sizeof(_lease)) != 0)
+        return LEASE_CHANGED;
+    };
+    return LEASE_UNCHANGED;
+  };
+
+  // Otherwise we are running on a cached or hard coded lease, and try DHCP when asked to or every so often
+  if (!_confirm && (millis() - _attemptMillis < DHCP_RETRY_TIME))
+    return LEASE_UNCHANGED;
+
+  _confirm = false;
+  _attemptMillis = millis();
+  if (Ethernet.begin(_mac, DHCP_TIMEOUT, DHCP_RESPONSE_TIMEOUT) == 1) {
+    _fromDHCP = true;
+    readSettings();
+  } else {
+    // The shield was reset for the attempt, so put the old settings back.  We keep trying every 
+    // DHCP_RETRY_TIME, and Ethernet.maintain() can't be used until DHCP answers again
+    _fromDHCP = false;
+    applyStatic();
+  };
+  return LEASE_CHANGED;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Configure the ethernet shield with _lease
+//
+void DHCPLeaseClass::applyStatic() {
+  Ethernet.begin(_mac, IPAddress(_lease.ip[0], _lease.ip[1], _lease.ip[2], _lease.ip[3]),
+    IPAddress(_lease.dns[0], _lease.dns[1], _lease.dns[2], _lease.dns[3]),
+    IPAddress(_lease.gateway[0], _lease.gateway[1], _lease.gateway[2], _lease.gateway[3]),
+    IPAddress(_lease.subnet[0], _lease.subnet[1], _lease.subnet[2], _lease.subnet[3]));
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Read the settings the ethernet shield is presently using into _lease
+//
+void DHCPLeaseClass::readSettings() {
+  IPAddress ip = Ethernet.localIP();
+  IPAddress gateway = Ethernet.gatewayIP();
+  IPAddress dns = Ethernet.dnsServerIP();
+  IPAddress subnet = Ethernet.subnetMask();
+
+  for (uint8_t i = 0; i < 4; i++) {
+    _lease.ip[i] = ip[i];
+    _lease.gateway[i] = gateway[i];
+    _lease.dns[i] = dns[i];
+    _lease.subnet[i] = subnet[i];
+  };
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getters for the settings the ethernet shield is presently using
+//
+void DHCPLeaseClass::getLease(struct lease_t *lease) {
+  *lease = _lease;
+  return;
+};
+
+bool DHCPLeaseClass::isFromDHCP() {
+  return _fromDHCP;
+};
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
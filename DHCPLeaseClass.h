@@ -0,0 +1,68 @@
+//
+// DHCPLeaseClass.h
+//
+// Data definition and function prototype file for DHCPLeaseClass.cpp, which
+// gets our network settings by DHCP without holding up polling
+//
+// The last lease is cached in EEPROM.  At power up we configure the ethernet
+// shield from the cached lease straight away, so that polling can start, and
+// confirm the lease with the DHCP server afterwards.  The modem is usually 
+// the DHCP server, so the lease is also confirmed after each modem power
+// cycle.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//
+//------------------------------------------------------------------------------
+#ifndef __DHCP_LEASE_CLASS_H
+#define __DHCP_LEASE_CLASS_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <Ethernet.h>
+
+// The network settings, as cached in EEPROM
+struct lease_t {
+  uint8_t ip[4];
+  uint8_t gateway[4];
+  uint8_t dns[4];
+  uint8_t subnet[4];
+};
+
+// Return values for maintain()
+#define LEASE_UNCHANGED   0    // Nothing happened, or the lease was renewed as it was
+#define LEASE_CHANGED     1    // The ethernet shield was reconfigured, so sockets must be reopened
+                               // and the lease cached again
+
+class DHCPLeaseClass {
+  private:
+    // Ethernet.begin() with DHCP blocks until it succeeds or times out, so these are kept short enough 
+    // to fit comfortably between polls
+    const uint32_t DHCP_TIMEOUT = 4000;               // Maximum time in ms for a DHCP attempt
+    const uint32_t DHCP_RESPONSE_TIMEOUT = 2000;      // Maximum time in ms to wait for each DHCP reply
+    const uint32_t DHCP_RETRY_TIME = 10UL*60*1000;    // Time in ms between attempts while DHCP isn't answering
+
+    uint8_t *_mac;
+    struct lease_t _lease;     // Settings the ethernet shield is presently using
+    bool _fromDHCP;            // true once the DHCP server has given us a lease (Ethernet.maintain() then renews it)
+    bool _confirm;             // true when the lease should be confirmed with the DHCP server
+    uint32_t _attemptMillis;   // millis() at the last DHCP attempt
+
+    void applyStatic();
+    void readSettings();
+
+  public:
+    DHCPLeaseClass();
+    int begin(uint8_t *, struct lease_t *, bool);
+    void confirm();
+    int maintain();
+    void getLease(struct lease_t *);
+    bool isFromDHCP();
+}; // class DHCPLeaseClass
+
+#endif
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
@@ -12,10 +12,18 @@
 //  Revision History
 //  ~~~~~~~~~~~~~~~~
 //    29 Oct 2024 MDS Original
+//    18 Oct 2026 MDS NTP server health is kept above the outage log
+//    18 Oct 2026 MDS Index based traversal for resumable history output
+//    18 Oct 2026 MDS Sparse, changed-only and decoded EEPROM dumps
+//    18 Oct 2026 MDS Cached DHCP lease
+//    18 Oct 2026 MDS Journal usage shown in the decoded dump
+//    18 Oct 2026 MDS Searches that leave the class cursor alone
 //
 //------------------------------------------------------------------------------
 #include "EEPROMRecordClass.h"
 
+volatile uint32_t EEPROMRecordClass::_dirtyRows = 0xffffffff;
+
 //
 //-----------------------------------------------------------------------------
 // Constructor
@@ -26,6 +34,28 @@ EEPROMRecordClass::EEPROMRecordClass() {
   return;
 };
 
+//
+//-----------------------------------------------------------------------------
+// Write a byte to the EEPROM if it has changed, and remember which dump row
+// it is in.  All EEPROM writes should come through here so that the changed
+// rows dump is complete.  This is also called from the timer interrupt, so
+// the bitmap is updated with interrupts off.
+//
+void EEPROMRecordClass::updateByte(int ind, uint8_t val) {
+  uint8_t oldSREG;
+
+  if (EEPROM.read(ind) == val)
+    return;
+
+  EEPROM.write(ind, val);
+
+  oldSREG = SREG;
+  cli();
+  _dirtyRows |= (uint32_t)1 << (ind / DUMP_ROW_SIZE);
+  SREG = oldSREG;
+  return;
+};
+
 //
 //-----------------------------------------------------------------------------
 // Return a dataset based upon the passed index
@@ -43,16 +73,40 @@ int EEPROMRecordClass::getDataFromIndex() {
   return 0;
 }
 
+//
+//-----------------------------------------------------------------------------
+// Read the record at the passed index straight into the passed local record.
+// Unlike getDataFromIndex(), this leaves EEPROMBlock alone, so it can be used
+// while a record is being built from the timer interrupt.
+//
+int EEPROMRecordClass::getRecordAt(int ind, struct modemRecord_t *dst) {
+  struct EEPROMRecord_t rec;
+
+  EEPROM.get(ind, rec);
+
+  dst->secsSince1900 = 
+    ((uint32_t)rec.secsSince1900_4 << 24) + 
+    ((uint32_t)rec.secsSince1900_3 << 16) + 
+    ((uint32_t)rec.secsSince1900_2 << 8) + 
+     (uint32_t)rec.secsSince1900_1;
+
+  dst->downMins = 
+    ((uint16_t)rec.downMins2 << 8) +
+     (uint16_t)rec.downMins1;
+
+  return 0;
+}
+
 //
 //-----------------------------------------------------------------------------
 // Get the index of the least recent modem record on the EEPROM (if it exists).
 // If no records exist then -1 is returned.
 //
 int EEPROMRecordClass::getOldestCompletedRecord() {
-  int i, emptyEEPROM = true, numRecords, count;
+  int i, emptyEEPROM = true, numRecords, count = 0;
   uint8_t flags;
 
-  numRecords = EEPROM.length()/sizeof(EEPROMRecord_t);
+  numRecords = OUTAGE_LOG_LENGTH/sizeof(EEPROMRecord_t);
 
   // The oldest record is the first one found working forward through the EEPROM 
   // past the record presently being built
@@ -64,7 +118,7 @@ int EEPROMRecordClass::getOldestCompletedRecord() {
 
     _modemRecordIndex = i;
     i += sizeof(EEPROMRecord_t);
-    if (i+7 >= EEPROM.length())
+    if (i+7 >= OUTAGE_LOG_LENGTH)
       return -1;
 
     EEPROM.get(i+7, flags);
@@ -80,7 +134,7 @@ int EEPROMRecordClass::getOldestCompletedRecord() {
   count = 1; // Start at 1 checked because we know one record is the 'IN_PROGRESS' record
   while ((count <= numRecords) && (flags != MODEM_RECORD_COMPLETE)) {
     i += sizeof(EEPROMRecord_t);
-    if (i >= EEPROM.length())
+    if (i >= OUTAGE_LOG_LENGTH)
       i = 0;
     EEPROM.get(i+7, flags);
     count++;
@@ -127,7 +181,7 @@ int EEPROMRecordClass::getRecordInProgress() {
   uint8_t flags;
 
   count = 0;
-  numRecords = EEPROM.length()/sizeof(EEPROMRecord_t);
+  numRecords = OUTAGE_LOG_LENGTH/sizeof(EEPROMRecord_t);
 
   i = 0;  // Look from start of EEPROM for valid entries
   EEPROM.get(i+7, flags);
@@ -136,8 +190,8 @@ int EEPROMRecordClass::getRecordInProgress() {
     _modemRecordIndex = i;
 
     i = _modemRecordIndex + sizeof(EEPROMRecord_t);
-    if (i >= EEPROM.length())
-      i -= EEPROM.length();
+    if (i >= OUTAGE_LOG_LENGTH)
+      i -= OUTAGE_LOG_LENGTH;
 
     EEPROM.get(i+7, flags);
     count++;
@@ -159,7 +213,7 @@ int EEPROMRecordClass::getNewestCompletedRecord() {
   int i, count = 0, numRecords;
   uint8_t flags;
 
-  numRecords = EEPROM.length()/sizeof(EEPROMRecord_t);
+  numRecords = OUTAGE_LOG_LENGTH/sizeof(EEPROMRecord_t);
 
   i = 0;  // Look from start of EEPROM for valid entries
   EEPROM.get(i+7, flags);
@@ -202,7 +256,7 @@ int EEPROMRecordClass::getIndexOfNextCompletedRecord() {
   uint8_t flags;
 
   i = _modemRecordIndex + sizeof(EEPROMRecord_t);
-  if (i >= EEPROM.length())
+  if (i >= OUTAGE_LOG_LENGTH)
     i = 0;
 
   EEPROM.get(i+7, flags);
@@ -226,7 +280,7 @@ int EEPROMRecordClass::getIndexOfPrevCompletedRecord() {
 
   i = _modemRecordIndex - sizeof(EEPROMRecord_t);
   if (i < 0)
-    i += EEPROM.length();
+    i += OUTAGE_LOG_LENGTH;
 
   EEPROM.get(i+7, flags);
 
@@ -238,6 +292,78 @@ int EEPROMRecordClass::getIndexOfPrevCompletedRecord() {
   return _modemRecordIndex;
 };
 
+//
+//-----------------------------------------------------------------------------
+// Overloaded versions : return the index of the completed record after/before
+// the passed index, or -1 if there is none.  _modemRecordIndex is left alone
+// so that callers can keep their own cursor into the list.
+//
+int EEPROMRecordClass::getIndexOfNextCompletedRecord(int ind) {
+  uint8_t flags;
+
+  ind += sizeof(EEPROMRecord_t);
+  if (ind >= OUTAGE_LOG_LENGTH)
+    ind = 0;
+
+  EEPROM.get(ind+7, flags);
+
+  return flags == MODEM_RECORD_COMPLETE ? ind : -1;
+};
+
+int EEPROMRecordClass::getIndexOfPrevCompletedRecord(int ind) {
+  uint8_t flags;
+
+  ind -= sizeof(EEPROMRecord_t);
+  if (ind < 0)
+    ind += OUTAGE_LOG_LENGTH;
+
+  EEPROM.get(ind+7, flags);
+
+  return flags == MODEM_RECORD_COMPLETE ? ind : -1;
+};
+
+//
+//-----------------------------------------------------------------------------
+// As getRecordInProgress() and getOldestCompletedRecord(), but _modemRecordIndex
+// is left alone.  These are for the serial commands, which run while the TIMER1
+// ISR may be saving the uptime stats through the class cursor.
+//
+int EEPROMRecordClass::findRecordInProgress() {
+  int i;
+  uint8_t flags;
+
+  for (i = 0; i < OUTAGE_LOG_LENGTH; i += sizeof(EEPROMRecord_t)) {
+    EEPROM.get(i+7, flags);
+    if (flags == MODEM_RECORD_IN_PROGRESS)
+      return i;
+  };
+
+  return -1;
+};
+
+int EEPROMRecordClass::findOldestCompletedRecord() {
+  int i, count, numRecords;
+  uint8_t flags;
+
+  numRecords = OUTAGE_LOG_LENGTH/sizeof(EEPROMRecord_t);
+
+  // The oldest record is the first completed one past the record being built
+  i = findRecordInProgress();
+  if (i < 0)
+    return -1;
+
+  for (count = 1; count < numRecords; count++) {
+    i += sizeof(EEPROMRecord_t);
+    if (i >= OUTAGE_LOG_LENGTH)
+      i = 0;
+    EEPROM.get(i+7, flags);
+    if (flags == MODEM_RECORD_COMPLETE)
+      return i;
+  };
+
+  return -1;
+};
+
 //
 //-----------------------------------------------------------------------------
 // completeLogEntry()
@@ -252,55 +378,55 @@ int EEPROMRecordClass::completeLogEntry() {
   if (_modemRecordIndex < 0)  // None found
     _modemRecordIndex = 0; // Create a new one at the beginning of the EEPROM
 
-  EEPROM.update(_modemRecordIndex, EEPROMBlock.secsSince1900_4);
-  EEPROM.update(_modemRecordIndex+1, EEPROMBlock.secsSince1900_3);
-  EEPROM.update(_modemRecordIndex+2, EEPROMBlock.secsSince1900_2);
-  EEPROM.update(_modemRecordIndex+3, EEPROMBlock.secsSince1900_1);
+  updateByte(_modemRecordIndex, EEPROMBlock.secsSince1900_4);
+  updateByte(_modemRecordIndex+1, EEPROMBlock.secsSince1900_3);
+  updateByte(_modemRecordIndex+2, EEPROMBlock.secsSince1900_2);
+  updateByte(_modemRecordIndex+3, EEPROMBlock.secsSince1900_1);
 
-  EEPROM.update(_modemRecordIndex+4, EEPROMBlock.downMins2);
-  EEPROM.update(_modemRecordIndex+5, EEPROMBlock.downMins1);
+  updateByte(_modemRecordIndex+4, EEPROMBlock.downMins2);
+  updateByte(_modemRecordIndex+5, EEPROMBlock.downMins1);
 
-  EEPROM.update(_modemRecordIndex+7, MODEM_RECORD_COMPLETE);
+  updateByte(_modemRecordIndex+7, MODEM_RECORD_COMPLETE);
 
   // Point to next record
   _modemRecordIndex += sizeof(EEPROMRecord_t);
-  if (_modemRecordIndex >= EEPROM.length())
-    _modemRecordIndex -= EEPROM.length();
+  if (_modemRecordIndex >= OUTAGE_LOG_LENGTH)
+    _modemRecordIndex -= OUTAGE_LOG_LENGTH;
 
   // Initalise the new record
-  EEPROM.update(_modemRecordIndex, EEPROMBlock.secsSince1900_4);
-  EEPROM.update(_modemRecordIndex+1, EEPROMBlock.secsSince1900_3);
-  EEPROM.update(_modemRecordIndex+2, EEPROMBlock.secsSince1900_2);
-  EEPROM.update(_modemRecordIndex+3, EEPROMBlock.secsSince1900_1);
+  updateByte(_modemRecordIndex, EEPROMBlock.secsSince1900_4);
+  updateByte(_modemRecordIndex+1, EEPROMBlock.secsSince1900_3);
+  updateByte(_modemRecordIndex+2, EEPROMBlock.secsSince1900_2);
+  updateByte(_modemRecordIndex+3, EEPROMBlock.secsSince1900_1);
 
-  EEPROM.update(_modemRecordIndex+4, 0);
-  EEPROM.update(_modemRecordIndex+5, 0);
+  updateByte(_modemRecordIndex+4, 0);
+  updateByte(_modemRecordIndex+5, 0);
 
-  EEPROM.update(_modemRecordIndex+7, MODEM_RECORD_IN_PROGRESS);
+  updateByte(_modemRecordIndex+7, MODEM_RECORD_IN_PROGRESS);
 
   return;
 }; // completeLogEntry()
 
 //
 //-----------------------------------------------------------------------------
-// Clear log by writing the EEPROM with 0xff values. _modemRecordIndex is left
+// Clear log by writing the outage log area of the EEPROM with 0xff values. _modemRecordIndex is left
 // unchanged and will contain the first record of the new list (to equalise wear
 // on all areas of the EEPROM)
 //
 int EEPROMRecordClass::clearLog() {
 
-  for (int i = 0; i<EEPROM.length(); i++)
-    EEPROM.update(i, MODEM_RECORD_UNUSED);
+  for (int i = 0; i<OUTAGE_LOG_LENGTH; i++)
+    updateByte(i, MODEM_RECORD_UNUSED);
 
-  EEPROM.update(_modemRecordIndex, EEPROMBlock.secsSince1900_4);
-  EEPROM.update(_modemRecordIndex+1, EEPROMBlock.secsSince1900_3);
-  EEPROM.update(_modemRecordIndex+2, EEPROMBlock.secsSince1900_2);
-  EEPROM.update(_modemRecordIndex+3, EEPROMBlock.secsSince1900_1);
+  updateByte(_modemRecordIndex, EEPROMBlock.secsSince1900_4);
+  updateByte(_modemRecordIndex+1, EEPROMBlock.secsSince1900_3);
+  updateByte(_modemRecordIndex+2, EEPROMBlock.secsSince1900_2);
+  updateByte(_modemRecordIndex+3, EEPROMBlock.secsSince1900_1);
 
-  EEPROM.update(_modemRecordIndex+4, EEPROMBlock.downMins2);
-  EEPROM.update(_modemRecordIndex+5, EEPROMBlock.downMins1);
+  updateByte(_modemRecordIndex+4, EEPROMBlock.downMins2);
+  updateByte(_modemRecordIndex+5, EEPROMBlock.downMins1);
 
-  EEPROM.update(_modemRecordIndex+7, MODEM_RECORD_IN_PROGRESS);
+  updateByte(_modemRecordIndex+7, MODEM_RECORD_IN_PROGRESS);
 
   return 0;
 };
@@ -317,7 +443,7 @@ int EEPROMRecordClass::setEEPROMUptimeStats() {
   short EEPROMlength;
   uint8_t flags;
 
-  EEPROMlength = EEPROM.length();
+  EEPROMlength = OUTAGE_LOG_LENGTH;
 
   // Find the entry with the EEPROM_ENTRY_IN_PROGRESS flag
   _modemRecordIndex = 0;
@@ -333,15 +459,15 @@ int EEPROMRecordClass::setEEPROMUptimeStats() {
   if (flags != MODEM_RECORD_IN_PROGRESS)
     _modemRecordIndex = 0;
 
-  EEPROM.update(_modemRecordIndex, EEPROMBlock.secsSince1900_4);
-  EEPROM.update(_modemRecordIndex+1, EEPROMBlock.secsSince1900_3);
-  EEPROM.update(_modemRecordIndex+2, EEPROMBlock.secsSince1900_2);
-  EEPROM.update(_modemRecordIndex+3, EEPROMBlock.secsSince1900_1);
+  updateByte(_modemRecordIndex, EEPROMBlock.secsSince1900_4);
+  updateByte(_modemRecordIndex+1, EEPROMBlock.secsSince1900_3);
+  updateByte(_modemRecordIndex+2, EEPROMBlock.secsSince1900_2);
+  updateByte(_modemRecordIndex+3, EEPROMBlock.secsSince1900_1);
 
-  EEPROM.update(_modemRecordIndex+4, EEPROMBlock.downMins2);
-  EEPROM.update(_modemRecordIndex+5, EEPROMBlock.downMins1);
+  updateByte(_modemRecordIndex+4, EEPROMBlock.downMins2);
+  updateByte(_modemRecordIndex+5, EEPROMBlock.downMins1);
 
-  EEPROM.update(_modemRecordIndex+7, MODEM_RECORD_IN_PROGRESS);
+  updateByte(_modemRecordIndex+7, MODEM_RECORD_IN_PROGRESS);
 
   return;
 }; // setEEPROMUptimeStats()
@@ -357,7 +483,7 @@ int EEPROMRecordClass::getEEPROMUptimeStats() {
   short EEPROMlength;
 
   found = false;
-  EEPROMlength = EEPROM.length();
+  EEPROMlength = OUTAGE_LOG_LENGTH;
 
   while ((i+7 < EEPROMlength) && (found != true)) {
     EEPROM.get(i+7, flags);
@@ -427,35 +553,208 @@ int EEPROMRecordClass::convertFromEEPROMBlock(struct modemRecord_t *dst) {
 
 //
 //-----------------------------------------------------------------------------
-// Send all EEPROM data out through serial port
+// Checksum over the data in the health slot starting at the passed index
+//
+uint8_t EEPROMRecordClass::getHealthChecksum(int ind, uint8_t len) {
+  uint8_t sum = 0xA5;
+
+  for (uint8_t i = 0; i < len; i++)
+    sum += EEPROM.read(ind + 3 + i);
+  return sum;
+};
+
+//
+//-----------------------------------------------------------------------------
+// getTargetHealth()
+//   Copies the most recently written NTP server health into the passed buffer.
+//   Returns 0 on success, or -1 if no valid health has been saved (in which
+//   case the buffer is left unchanged)
+//
+int EEPROMRecordClass::getTargetHealth(uint8_t *dst, uint8_t len) {
+  int i, ind = -1;
+  uint8_t seq, newestSeq;
+
+  if (len > TARGET_HEALTH_SLOT_SIZE - 3)
+    return -1;
+
+  for (i = TARGET_HEALTH_START; i < TARGET_HEALTH_START + TARGET_HEALTH_SLOTS*TARGET_HEALTH_SLOT_SIZE; i += TARGET_HEALTH_SLOT_SIZE) {
+    if ((EEPROM.read(i) != TARGET_HEALTH_MAGIC) || (EEPROM.read(i+2) != getHealthChecksum(i, len)))
+      continue;
+
+    seq = EEPROM.read(i+1);
+    if ((ind < 0) || ((int8_t)(seq - newestSeq) > 0)) {
+      ind = i;
+      newestSeq = seq;
+    };
+  };
+
+  if (ind < 0)
+    return -1;
+
+  for (i = 0; i < len; i++)
+    dst[i] = EEPROM.read(ind + 3 + i);
+  return 0;
+};
+
+//
+//-----------------------------------------------------------------------------
+// setTargetHealth()
+//   Saves the passed NTP server health to the older of the health slots, so
+//   that writes alternate between slots (halving the wear) and a write
+//   interrupted by a power failure still leaves the previous copy intact.
+//   The magic byte is written last so the slot only becomes valid once the
+//   data, checksum and sequence number are complete.
+//
+void EEPROMRecordClass::setTargetHealth(uint8_t *src, uint8_t len) {
+  int i, ind = TARGET_HEALTH_START, newest = -1;
+  uint8_t seq, newestSeq = 0;
+
+  if (len > TARGET_HEALTH_SLOT_SIZE - 3)
+    return;
+
+  // Find the newest valid slot, and write to the one after it
+  for (i = TARGET_HEALTH_START; i < TARGET_HEALTH_START + TARGET_HEALTH_SLOTS*TARGET_HEALTH_SLOT_SIZE; i += TARGET_HEALTH_SLOT_SIZE) {
+    if ((EEPROM.read(i) != TARGET_HEALTH_MAGIC) || (EEPROM.read(i+2) != getHealthChecksum(i, len)))
+      continue;
+
+    seq = EEPROM.read(i+1);
+    if ((newest < 0) || ((int8_t)(seq - newestSeq) > 0)) {
+      newest = i;
+      newestSeq = seq;
+    };
+  };
+
+  if (newest >= 0) {
+    ind = newest + TARGET_HEALTH_SLOT_SIZE;
+    if (ind >= TARGET_HEALTH_START + TARGET_HEALTH_SLOTS*TARGET_HEALTH_SLOT_SIZE)
+      ind = TARGET_HEALTH_START;
+  };
+
+  updateByte(ind, MODEM_RECORD_UNUSED); // Invalidate the slot while it is rewritten
+  for (i = 0; i < len; i++)
+    updateByte(ind + 3 + i, src[i]);
+  updateByte(ind+2, getHealthChecksum(ind, len));
+  updateByte(ind+1, newestSeq + 1);
+  updateByte(ind, TARGET_HEALTH_MAGIC);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// getCachedLease()
+//   Copies the last DHCP lease into the passed buffer.  The lease is laid out
+//   as magic, checksum, then the data.  Returns 0 on success, or -1 if no 
+//   valid lease has been saved (in which case the buffer is left unchanged)
+//
+int EEPROMRecordClass::getCachedLease(uint8_t *dst, uint8_t len) {
+  uint8_t sum = 0xA5;
+
+  if ((len > LEASE_SIZE - 2) || (EEPROM.read(LEASE_START) != LEASE_MAGIC))
+    return -1;
+
+  for (uint8_t i = 0; i < len; i++)
+    sum += EEPROM.read(LEASE_START + 2 + i);
+  if (sum != EEPROM.read(LEASE_START + 1))
+    return -1;
+
+  for (uint8_t i = 0; i < len; i++)
+    dst[i] = EEPROM.read(LEASE_START + 2 + i);
+  return 0;
+};
+
+//
+//-----------------------------------------------------------------------------
+// setCachedLease()
+//   Saves the passed DHCP lease.  Leases rarely change, and only the changed
+//   bytes are written, so this doesn't need wear levelling.
+//
+void EEPROMRecordClass::setCachedLease(uint8_t *src, uint8_t len) {
+  uint8_t sum = 0xA5;
+
+  if (len > LEASE_SIZE - 2)
+    return;
+
+  for (uint8_t i = 0; i < len; i++)
+    sum += src[i];
+
+  // Skip the write altogether if nothing has changed, otherwise invalidate the lease while it is rewritten
+  if ((EEPROM.read(LEASE_START) == LEASE_MAGIC) && (EEPROM.read(LEASE_START + 1) == sum)) {
+    uint8_t i;
+    for (i = 0; (i < len) && (EEPROM.read(LEASE_START + 2 + i) == src[i]); i++)
+      ;
+    if (i == len)
+      return;
+  };
+
+  updateByte(LEASE_START, MODEM_RECORD_UNUSED);
+  for (uint8_t i = 0; i < len; i++)
+    updateByte(LEASE_START + 2 + i, src[i]);
+  updateByte(LEASE_START + 1, sum);
+  updateByte(LEASE_START, LEASE_MAGIC);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Send EEPROM data out through serial port, in one of the following modes:
+//   DUMP_ALL     : Every row
+//   DUMP_SPARSE  : Rows which are all 0xFF (unused) are skipped
+//   DUMP_CHANGED : Only the rows which have been written since the last dump
+//   DUMP_RECORDS : The outage log and health slots decoded rather than in hex
+// Every dump resets the record of which rows have changed
 // *** Port must have already been initialised
 //
-void EEPROMRecordClass::dumpEEPROM() {
-  int row = 0;
+void EEPROMRecordClass::dumpEEPROM(uint8_t mode) {
+  int row = 0, skipped = 0;
   short EEPROMlength;
-  char buffer[124];
+  uint32_t dirtyRows;
+  uint8_t oldSREG;
 
   EEPROMlength = EEPROM.length();
 
+  oldSREG = SREG;
+  cli();
+  dirtyRows = _dirtyRows;
+  _dirtyRows = 0;
+  SREG = oldSREG;
+
   Serial.print(F(
     "\r\n"
-    "                                                --- EEPROM DUMP ---\r\n"
-    "   Hex  Dec                                                                                                      Dec  Hex\r\n"));
-
-  while (row * 32 < EEPROMlength) {
-    sprintf(buffer, "  %04X %04d", row*32, row*32);
-    for (int i = 0; i < 32; i++) {
-      if (i%8 == 0)
-        sprintf(buffer, "%s ", buffer);
-      int location = (row * 32) + i;
-      if (location < EEPROMlength)
-        sprintf(buffer, "%s %02X", buffer, EEPROM.read(location));
+    "                                                --- EEPROM DUMP ---\r\n"));
+
+  if (mode == DUMP_RECORDS) {
+    dumpRecords();
+  } else {
+    Serial.print(F(
+      "   Hex  Dec                                                                                                      Dec  Hex\r\n"));
+
+    while (row * DUMP_ROW_SIZE < EEPROMlength) {
+      bool show = true;
+
+      if (mode == DUMP_CHANGED) {
+        show = (dirtyRows & ((uint32_t)1 << row)) != 0;
+      } else if (mode == DUMP_SPARSE) {
+        show = false;
+        for (int i = row * DUMP_ROW_SIZE; (i < (row + 1) * DUMP_ROW_SIZE) && (i < EEPROMlength); i++)
+          if (EEPROM.read(i) != MODEM_RECORD_UNUSED)
+            show = true;
+      };
+
+      if (show)
+        dumpRow(row);
       else
-        sprintf(buffer, "%s   ", buffer);
-    }
-    sprintf(buffer, "%s  %04d %04X", buffer, ((row+1)*32)-1, ((row+1)*32)-1);
-    Serial.println(buffer);
-    row++;
+        skipped++;
+      row++;
+    };
+
+    if (skipped > 0) {
+      Serial.print(F("  "));
+      Serial.print(skipped);
+      if (mode == DUMP_CHANGED)
+        Serial.print(F(" unchanged rows not shown\r\n"));
+      else
+        Serial.print(F(" unused rows not shown\r\n"));
+    };
   };
 
   Serial.print(F(
@@ -464,6 +763,88 @@ void EEPROMRecordClass::dumpEEPROM() {
   return;
 };
 
+//
+//-----------------------------------------------------------------------------
+// Send one row of the EEPROM out through serial port in hex
+//
+void EEPROMRecordClass::dumpRow(int row) {
+  short EEPROMlength;
+  char buffer[124];
+
+  EEPROMlength = EEPROM.length();
+
+  sprintf(buffer, "  %04X %04d", row*DUMP_ROW_SIZE, row*DUMP_ROW_SIZE);
+  for (int i = 0; i < DUMP_ROW_SIZE; i++) {
+    if (i%8 == 0)
+      sprintf(buffer, "%s ", buffer);
+    int location = (row * DUMP_ROW_SIZE) + i;
+    if (location < EEPROMlength)
+      sprintf(buffer, "%s %02X", buffer, EEPROM.read(location));
+    else
+      sprintf(buffer, "%s   ", buffer);
+  }
+  sprintf(buffer, "%s  %04d %04X", buffer, ((row+1)*DUMP_ROW_SIZE)-1, ((row+1)*DUMP_ROW_SIZE)-1);
+  Serial.println(buffer);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Send the used outage log slots, the health slots and the lease out through
+// serial port, decoded into their fields, along with how full the journal is
+//
+void EEPROMRecordClass::dumpRecords() {
+  struct EEPROMRecord_t rec;
+  struct modemRecord_t mRec;
+  char buffer[80];
+  int i, unused = 0;
+
+  Serial.print(F("  Outage log:\r\n"));
+  for (i = 0; i < OUTAGE_LOG_LENGTH; i += sizeof(EEPROMRecord_t)) {
+    EEPROM.get(i, rec);
+    if (rec.flags == MODEM_RECORD_UNUSED) {
+      unused++;
+      continue;
+    };
+
+    getRecordAt(i, &mRec);
+    sprintf(buffer, "    %04X  %-11S  secsSince1900 %10lu  downMins %5u", i, 
+      rec.flags == MODEM_RECORD_COMPLETE ? PSTR("complete") : 
+      rec.flags == MODEM_RECORD_IN_PROGRESS ? PSTR("in progress") : PSTR("corrupt"),  // %S format specifier is Arduino AVR-GCC specific
+      mRec.secsSince1900, mRec.downMins);
+    Serial.println(buffer);
+  };
+  Serial.print(F("    "));
+  Serial.print(unused);
+  Serial.print(F(" unused slots\r\n"));
+
+  Serial.print(F("  NTP server health:\r\n"));
+  for (i = TARGET_HEALTH_START; i < TARGET_HEALTH_START + TARGET_HEALTH_SLOTS*TARGET_HEALTH_SLOT_SIZE; i += TARGET_HEALTH_SLOT_SIZE) {
+    if (EEPROM.read(i) == TARGET_HEALTH_MAGIC)
+      sprintf(buffer, "    %04X  sequence %3u  checksum %02X", i, EEPROM.read(i+1), EEPROM.read(i+2));
+    else
+      sprintf(buffer, "    %04X  unused", i);
+    Serial.println(buffer);
+  };
+
+  Serial.print(F("  DHCP lease:\r\n"));
+  if (EEPROM.read(LEASE_START) == LEASE_MAGIC)
+    sprintf(buffer, "    %04X  address %u.%u.%u.%u", LEASE_START, EEPROM.read(LEASE_START+2), EEPROM.read(LEASE_START+3),
+      EEPROM.read(LEASE_START+4), EEPROM.read(LEASE_START+5));
+  else
+    sprintf(buffer, "    %04X  unused", LEASE_START);
+  Serial.println(buffer);
+
+  // The journal is decoded event by event with the J command, so just show how full it is
+  unused = 0;
+  for (i = JOURNAL_START; i < JOURNAL_START + JOURNAL_LENGTH; i += 3)
+    if (EEPROM.read(i) == MODEM_RECORD_UNUSED)
+      unused++;
+  sprintf(buffer, "  Journal:\r\n    %04X  %u of %u events used", JOURNAL_START, JOURNAL_LENGTH/3 - unused, JOURNAL_LENGTH/3);
+  Serial.println(buffer);
+  return;
+};
+
 //-----------------------------------------------------------------------------
 // End of file
 //-----------------------------------------------------------------------------
@@ -12,6 +12,13 @@
 //  Revision History
 //  ~~~~~~~~~~~~~~~~
 //    29 Oct 2024 MDS Original
+//    18 Oct 2026 MDS Outage log bounded to make room for NTP server health
+//    18 Oct 2026 MDS Index based traversal for resumable history output
+//    18 Oct 2026 MDS Sparse, changed-only and decoded EEPROM dumps
+//    18 Oct 2026 MDS Cached DHCP lease
+//    18 Oct 2026 MDS Space for the state change journal
+//    18 Oct 2026 MDS Searches that leave the class cursor alone
+//    18 Oct 2026 MDS New health slot magic for the smaller server health
 //
 //------------------------------------------------------------------------------
 #ifndef __MODEM_RECORD_CLASS_H
@@ -21,6 +28,31 @@
 #include <EEPROM.h>
 #include "ModemMonitor.h"
 
+// EEPROM map (the Uno has 1024 bytes):
+//   0x000 - 0x27F  Outage log; 80 records of 8 bytes as a circular list
+//   0x280 - 0x2FF  NTP server health; two alternating 64 byte slots
+//   0x300 - 0x31F  Last DHCP lease
+//   0x320 - 0x3FD  State change journal; 74 events of 3 bytes as a circular list
+//   0x3FE - 0x3FF  Unallocated
+#define OUTAGE_LOG_LENGTH          0x280
+#define TARGET_HEALTH_START        0x280
+#define TARGET_HEALTH_SLOT_SIZE    64
+#define TARGET_HEALTH_SLOTS        2
+#define TARGET_HEALTH_MAGIC        0x4E // First byte of a written health slot (changed with the layout, so
+                                        // that a slot written by older software isn't read back)
+#define LEASE_START                0x300
+#define LEASE_SIZE                 32
+#define LEASE_MAGIC                0x4C // First byte of a written lease
+#define JOURNAL_START              0x320
+#define JOURNAL_LENGTH             222
+
+// Modes for dumpEEPROM()
+#define DUMP_ALL                   0    // Every row
+#define DUMP_SPARSE                1    // Skip rows which are all 0xFF
+#define DUMP_CHANGED               2    // Only rows written since the last dump
+#define DUMP_RECORDS               3    // Decode the outage log, health slots, lease and journal
+#define DUMP_ROW_SIZE              32   // Bytes per row of the dump (the Uno's EEPROM is 32 rows)
+
 // Outages are remembered in a group of 8 bytes in EEPROM as a circular list
 
 // For flags uint8_t in the EEPROM record
@@ -53,6 +85,15 @@ class EEPROMRecordClass {
       uint8_t flags;
     } EEPROMBlock;
 
+    // Each health slot is laid out as magic, sequence, checksum, then the data
+    uint8_t getHealthChecksum(int, uint8_t);
+
+    // One bit per dump row, set when a byte in the row is changed.  Everything counts as changed at power up
+    static volatile uint32_t _dirtyRows;
+
+    void dumpRow(int);
+    void dumpRecords();
+
   public:
     EEPROMRecordClass();
     int convertToEEPROMBlock(struct modemRecord_t *);
@@ -63,13 +104,23 @@ class EEPROMRecordClass {
     int getNewestCompletedRecord();
     int getIndexOfNextCompletedRecord();
     int getIndexOfPrevCompletedRecord();
+    int getIndexOfNextCompletedRecord(int);
+    int getIndexOfPrevCompletedRecord(int);
+    int findRecordInProgress();
+    int findOldestCompletedRecord();
     int getDataFromIndex(int);
     int getDataFromIndex();
+    int getRecordAt(int, struct modemRecord_t *);
     int completeLogEntry();
     int getEEPROMUptimeStats();
     int setEEPROMUptimeStats();
     int clearLog();
-    void dumpEEPROM();
+    int getTargetHealth(uint8_t *, uint8_t);
+    void setTargetHealth(uint8_t *, uint8_t);
+    int getCachedLease(uint8_t *, uint8_t);
+    void setCachedLease(uint8_t *, uint8_t);
+    void dumpEEPROM(uint8_t);
+    static void updateByte(int, uint8_t);
 }; // class EEPROMRecordClass
 
 #endif
@@ -0,0 +1,153 @@
+//
+// FailureDetectorClass.cpp
+//
+// Contains the methods for the FailureDetectorClass, which turns the history
+// of successful NTP poll replies into a suspicion level (phi) that the link
+// to the internet has gone down.
+//
+// The normal distribution's tail probability is approximated with the
+// logistic function used by Akka's phi-accrual detector, which is accurate to
+// a fraction of a percent and avoids having to compute erfc() on the Uno.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS Replies that only show the link is up restart the silence without adding an interval
+//
+//------------------------------------------------------------------------------
+#include "FailureDetectorClass.h"
+
+//
+//-----------------------------------------------------------------------------
+// Constructor
+FailureDetectorClass::FailureDetectorClass() {
+  _numIntervals = 0;
+  _nextInterval = 0;
+  _haveHeartbeat = false;
+  _expectedInterval = 60000;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Pass in the normal interval between polls in ms.  This is used as the mean
+// of the distribution until we have seen enough replies to measure it
+//
+void FailureDetectorClass::begin(uint32_t expectedInterval) {
+  _expectedInterval = expectedInterval;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Record a successful reply received at the passed millis() time
+//
+void FailureDetectorClass::heartbeat(uint32_t now) {
+  uint32_t interval;
+
+  if (_haveHeartbeat) {
+    interval = (now - _lastHeartbeat) / INTERVAL_UNIT;
+    if (interval > 0xffff)
+      interval = 0xffff;
+
+    _intervals[_nextInterval] = interval;
+    _nextInterval++;
+    if (_nextInterval >= WINDOW_SIZE)
+      _nextInterval = 0;
+    if (_numIntervals < WINDOW_SIZE)
+      _numIntervals++;
+  };
+
+  _lastHeartbeat = now;
+  _lastAlive = now;
+  _haveHeartbeat = true;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Record a reply at the passed millis() time that shows the link is up but
+// wasn't a successful poll (eg a Kiss-o'-Death).  These are followed straight
+// away by a poll of another server, so the gap to them isn't a normal reply
+// interval - the silence is timed from here, but the distribution is left
+// alone.  Does nothing before the first successful reply.
+//
+void FailureDetectorClass::alive(uint32_t now) {
+  if (_haveHeartbeat)
+    _lastAlive = now;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Forget the last reply time (but not the learnt distribution).  Called when
+// the modem is power cycled, so that the interval spanning the outage and the
+// modem's arbitration isn't counted as a normal reply interval
+//
+void FailureDetectorClass::restart() {
+  _haveHeartbeat = false;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Calculate the mean and standard deviation (in ms) of the reply intervals
+//
+void FailureDetectorClass::getDistribution(float *mean, float *stdDev) {
+  float sum = 0, sumSq = 0, variance;
+
+  if (_numIntervals < 2) {
+    // Not enough history yet - assume the link behaves as configured
+    *mean = _expectedInterval;
+    *stdDev = _expectedInterval / 4;
+    return;
+  };
+
+  for (uint8_t i = 0; i < _numIntervals; i++) {
+    float x = (float)_intervals[i] * INTERVAL_UNIT;
+    sum += x;
+    sumSq += x * x;
+  };
+
+  *mean = sum / _numIntervals;
+  variance = (sumSq / _numIntervals) - (*mean * *mean);
+  *stdDev = variance > 0 ? sqrt(variance) : 0;
+
+  if (*stdDev < MIN_STD_DEV)
+    *stdDev = MIN_STD_DEV;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns the suspicion level that the link is down at the passed millis()
+// time.  Returns 0 if there has been no reply since begin() or restart(),
+// since we then have nothing to measure from.
+//
+float FailureDetectorClass::getPhi(uint32_t now) {
+  float mean, stdDev, y, e;
+
+  if (!_haveHeartbeat)
+    return 0;
+
+  getDistribution(&mean, &stdDev);
+
+  y = ((float)(now - _lastAlive) - mean) / stdDev;
+  e = exp(-y * (1.5976 + 0.070566 * y * y));
+
+  if (y > 0)
+    return -log10(e / (1.0 + e));
+  return -log10(1.0 - 1.0 / (1.0 + e));
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getter for the number of reply intervals the distribution is built from
+//
+uint8_t FailureDetectorClass::getNumIntervals() {
+  return _numIntervals;
+};
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
@@ -0,0 +1,60 @@
+//
+// FailureDetectorClass.h
+//
+// Data definition and function prototype file for FailureDetectorClass.cpp,
+// a phi-accrual failure detector fed by successful NTP poll replies
+//
+// Rather than counting missed replies, the detector learns the distribution of
+// the intervals between successful replies and expresses the time since the
+// last reply as a suspicion level, phi:
+//
+//   phi = -log10(probability that a reply would still arrive this late)
+//
+// so phi = 1 means a 10% chance that the link is still fine, phi = 2 a 1%
+// chance, and so on.  A link with erratic replies builds up a wide distribution
+// and is given more tolerance; a link that replies like clockwork is declared
+// dead soon after it stops.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS Replies that only show the link is up restart the silence without adding an interval
+//
+//------------------------------------------------------------------------------
+#ifndef __FAILURE_DETECTOR_CLASS_H
+#define __FAILURE_DETECTOR_CLASS_H
+
+#include <Arduino.h>
+
+class FailureDetectorClass {
+  private:
+    static const uint8_t  WINDOW_SIZE = 16;      // Number of reply intervals remembered
+    static const uint16_t INTERVAL_UNIT = 100;   // Intervals are stored in 100ms units to fit in 16 bits
+    static const uint16_t MIN_STD_DEV = 2000;    // Floor on the standard deviation in ms, so that a perfectly
+                                                 // regular link doesn't become infinitely intolerant
+
+    uint16_t _intervals[WINDOW_SIZE];  // Circular list of intervals between successful replies
+    uint8_t  _numIntervals;            // Number of valid entries in _intervals[]
+    uint8_t  _nextInterval;            // Where the next interval will be written in _intervals[]
+    uint32_t _lastHeartbeat;           // millis() at the last successful reply
+    uint32_t _lastAlive;               // millis() at the last reply of any kind, which the silence is timed from
+    bool     _haveHeartbeat;           // false until the first reply after begin() or restart()
+    uint32_t _expectedInterval;        // Used to seed the distribution until we have real samples
+
+    void getDistribution(float *, float *);
+
+  public:
+    FailureDetectorClass();
+    void begin(uint32_t);
+    void heartbeat(uint32_t);
+    void alive(uint32_t);
+    void restart();
+    float getPhi(uint32_t);
+    uint8_t getNumIntervals();
+}; // class FailureDetectorClass
+
+#endif
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
@@ -0,0 +1,142 @@
+//
+// FaultInjectionClass.cpp
+//
+// Contains the methods for the FaultInjectionClass, which runs the simulated
+// internet fault scenarios.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS RTTs over 255ms
+//    18 Oct 2026 MDS Replies lost inside NTPClass, before they count for anything
+//
+//------------------------------------------------------------------------------
+#include "FaultInjectionClass.h"
+
+// Scenario 1 is what the F command has always done, so it must stay first
+const struct faultScenario_t scenarios[] PROGMEM = {
+  {FAULT_LINK_DOWN,   0,   0, "Link down until stopped"},
+  {FAULT_LINK_DOWN,   0,  10, "Link down for 10 minutes"},
+  {FAULT_LINK_DOWN,   0,  30, "Link down for 30 minutes"},
+  {FAULT_LOSS,       30,  10, "30% loss for 10 minutes"},
+  {FAULT_LOSS,        5, 360, "5% loss for 6 hours"},
+  {FAULT_DNS,         0,  30, "DNS failing for 30 minutes"},
+  {FAULT_HIGH_RTT,   80, 360, "RTT up 80ms for 6 hours"}
+};
+const uint8_t NUM_SCENARIOS = sizeof(scenarios) / sizeof(scenarios[0]);
+
+//
+//-----------------------------------------------------------------------------
+// Constructor
+FaultInjectionClass::FaultInjectionClass() {
+  _scenario = 0;
+  _fault = FAULT_NONE;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Start the passed scenario (1 based), replacing any that is running.
+//
+// Returns true if it was started, false if there is no such scenario
+//
+bool FaultInjectionClass::start(uint8_t scenario) {
+  if ((scenario == 0) || (scenario > NUM_SCENARIOS))
+    return false;
+
+  _scenario = scenario;
+  _fault = pgm_read_byte(&scenarios[scenario-1].fault);
+  _amount = pgm_read_byte(&scenarios[scenario-1].amount);
+  _duration = (uint32_t)pgm_read_word(&scenarios[scenario-1].durationMins) * 60000;
+  _startMillis = millis();
+  return true;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Stop the scenario that is running
+//
+void FaultInjectionClass::stop() {
+  _scenario = 0;
+  _fault = FAULT_NONE;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Call regularly.  Returns true (once) when the running scenario has just 
+// stopped because its time is up
+//
+bool FaultInjectionClass::expired() {
+  if ((_scenario == 0) || (_duration == 0) || (millis() - _startMillis < _duration))
+    return false;
+
+  stop();
+  return true;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getter for the scenario running, 0 if none
+//
+uint8_t FaultInjectionClass::getScenario() {
+  return _scenario;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getter for the number of scenarios
+//
+uint8_t FaultInjectionClass::getNumScenarios() {
+  return NUM_SCENARIOS;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getter for the description of the passed scenario (1 based)
+//
+void FaultInjectionClass::getScenarioName(uint8_t scenario, char *b) {
+  if ((scenario == 0) || (scenario > NUM_SCENARIOS))
+    *b = '\0';
+  else
+    strcpy_P(b, scenarios[scenario-1].name);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns true if the poll should fail without anything being sent
+//
+bool FaultInjectionClass::isLinkDown() {
+  return _fault == FAULT_LINK_DOWN;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns true if DNS lookups should fail
+//
+bool FaultInjectionClass::isDNSFailing() {
+  return _fault == FAULT_DNS;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns the percentage of replies that NTPClass should throw away
+//
+uint8_t FaultInjectionClass::getReplyLoss() {
+  return _fault == FAULT_LOSS ? _amount : 0;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns the passed RTT in ms with any simulated extra time added
+//
+uint16_t FaultInjectionClass::adjustRTT(uint16_t rtt) {
+  if (_fault != FAULT_HIGH_RTT)
+    return rtt;
+  return rtt + _amount;
+};
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
@@ -0,0 +1,68 @@
+//
+// FaultInjectionClass.h
+//
+// Data definition and function prototype file for FaultInjectionClass.cpp,
+// which simulates internet faults at the poll level so that the restart 
+// logic and the failure detection can be tried out on real hardware without
+// pulling cables
+//
+// Each scenario is a fault and how long it lasts.  Nothing here blocks - 
+// simulated failures wait no longer than a lost NTP reply, rather than 
+// waiting out a DNS timeout, and the scenario ends itself when its time is up.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS RTTs over 255ms
+//    18 Oct 2026 MDS Replies lost inside NTPClass, before they count for anything
+//    18 Oct 2026 MDS Link down simulated inside NTPClass, so polls keep their normal pacing
+//    18 Oct 2026 MDS DNS failure leaves the cached server addresses alone
+//
+//------------------------------------------------------------------------------
+#ifndef __FAULT_INJECTION_CLASS_H
+#define __FAULT_INJECTION_CLASS_H
+
+#include <Arduino.h>
+
+// Faults
+#define FAULT_NONE        0
+#define FAULT_LINK_DOWN   1   // No poll is answered
+#define FAULT_LOSS        2   // A percentage of the answered polls are thrown away
+#define FAULT_DNS         3   // DNS lookups fail, but servers with a cached address still answer until the
+                              // address is due to be looked up again
+#define FAULT_HIGH_RTT    4   // Time is added to the RTT of every answered poll
+
+struct faultScenario_t {
+  uint8_t  fault;
+  uint8_t  amount;        // Percentage lost for FAULT_LOSS, ms added for FAULT_HIGH_RTT
+  uint16_t durationMins;  // 0 to run until stopped
+  char     name[36];
+};
+
+class FaultInjectionClass {
+  private:
+    uint8_t  _scenario;       // Scenario running (1 based), 0 if none
+    uint8_t  _fault;
+    uint8_t  _amount;
+    uint32_t _duration;       // ms, 0 to run until stopped
+    uint32_t _startMillis;
+
+  public:
+    FaultInjectionClass();
+    bool start(uint8_t);
+    void stop();
+    bool expired();
+    uint8_t getScenario();
+    uint8_t getNumScenarios();
+    void getScenarioName(uint8_t, char *);
+    bool isLinkDown();
+    bool isDNSFailing();
+    uint8_t getReplyLoss();
+    uint16_t adjustRTT(uint16_t);
+}; // class FaultInjectionClass
+
+#endif
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
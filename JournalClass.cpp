@@ -0,0 +1,210 @@
+//
+// JournalClass.cpp
+//
+// Contains the methods for the JournalClass, which writes events to, and 
+// reads them back from, the journal in EEPROM.
+//
+// Being a circular list, every slot is written in turn, so wear is spread 
+// evenly over the journal's part of the EEPROM.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//
+//------------------------------------------------------------------------------
+#include "JournalClass.h"
+
+const char eventName[][20] PROGMEM = {
+  "Power up",        "Time",            "Time",            "Poll failed",     "Modem restart",
+  "Power restored",  "Online",          "Arbitration over","LED set",         "Relay set",
+  "Fault simulation","Kiss-o'-Death",   "Falseticker",     "Network settings","Log cleared",
+  "Unknown"
+};
+
+//
+//-----------------------------------------------------------------------------
+// Constructor
+JournalClass::JournalClass() {
+  _next = 0;
+  _lap = 0;
+  _lastMillis = 0;
+  _anchored = false;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Find where the last event was written, and log that we have powered up.
+//
+// The events from the start of the list up to the last one written all have
+// the same lap flag, so the next slot is the first one which is unused or
+// has a different lap flag
+//
+void JournalClass::begin() {
+  uint8_t first, code;
+
+  first = EEPROM.read(JOURNAL_START);
+  _next = 0;
+  _lap = 0;
+
+  if (first != MODEM_RECORD_UNUSED) {
+    _lap = first & 0x80;
+    for (_next = 1; _next < JOURNAL_SLOTS; _next++) {
+      code = EEPROM.read(JOURNAL_START + _next*3);
+      if ((code == MODEM_RECORD_UNUSED) || ((code & 0x80) != _lap))
+        break;
+    };
+
+    // We have come to the end of the list on this lap, so start the next one
+    if (_next >= JOURNAL_SLOTS) {
+      _next = 0;
+      _lap ^= 0x80;
+    };
+  };
+
+  _lastMillis = millis();
+  log(EV_BOOT, 0);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Write an event with the passed code, argument and data to the next slot. The
+// code byte is written last, so a slot is never valid with half written data
+//
+void JournalClass::write(uint8_t code, uint8_t arg, uint16_t data) {
+  int ind = JOURNAL_START + _next*3;
+
+  EEPROMRecordClass::updateByte(ind+1, data >> 8);
+  EEPROMRecordClass::updateByte(ind+2, data & 0xff);
+  EEPROMRecordClass::updateByte(ind, _lap | ((code & 0x0f) << 3) | (arg & 0x07));
+
+  _next++;
+  if (_next >= JOURNAL_SLOTS) {
+    _next = 0;
+    _lap ^= 0x80;
+  };
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Log an event with the passed code and argument, timed from the previous one.
+// Times under 9 hours are logged to the second, longer times to the minute.
+// Whatever wasn't logged is carried over to the next event so that the times
+// don't drift.
+//
+void JournalClass::log(uint8_t code, uint8_t arg) {
+  uint32_t elapsed = millis() - _lastMillis;
+  uint16_t data;
+
+  if (elapsed / 1000 <= 0x7fff) {
+    data = elapsed / 1000;
+    _lastMillis += (uint32_t)data * 1000;
+  } else {
+    elapsed /= 60000;
+    data = elapsed > 0x7fff ? 0x7fff : elapsed;
+    _lastMillis += (uint32_t)data * 60000;
+    data |= 0x8000;
+  };
+
+  write(code, arg, data);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Pass in the present time in seconds since 1900.  The first time after power
+// up, and once a day after that, this anchors the journal to the clock so that
+// the decoder can show the real time of each event
+//
+void JournalClass::setTime(uint32_t secsSince1900) {
+  if ((secsSince1900 == 0) || (_anchored && (millis() - _anchorMillis < ANCHOR_TIME)))
+    return;
+
+  _anchored = true;
+  _anchorMillis = millis();
+  _lastMillis = _anchorMillis;
+  write(EV_TIME_HIGH, 0, secsSince1900 >> 16);
+  write(EV_TIME_LOW, 0, secsSince1900 & 0xffff);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns the slot of the oldest event, or -1 if the journal is empty
+//
+int JournalClass::getOldest() {
+  if (EEPROM.read(JOURNAL_START + _next*3) != MODEM_RECORD_UNUSED)
+    return _next;   // The list has wrapped, so the oldest event is the next to be overwritten
+  if (_next == 0)
+    return -1;
+  return 0;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns the slot of the passed number of events back from the newest one,
+// (or the oldest event if there aren't that many), or -1 if the journal is
+// empty
+//
+int JournalClass::getNewest(uint8_t back) {
+  int oldest = getOldest(), ind;
+  uint8_t count;
+
+  if (oldest < 0)
+    return -1;
+
+  count = _next > oldest ? _next - oldest : _next + JOURNAL_SLOTS - oldest;
+  if (back >= count)
+    return oldest;
+
+  ind = (int)_next - back;
+  if (ind < 0)
+    ind += JOURNAL_SLOTS;
+  return ind;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns the slot of the event after the passed one, or -1 at the newest 
+// event
+//
+int JournalClass::getNext(int ind) {
+  ind++;
+  if (ind >= JOURNAL_SLOTS)
+    ind = 0;
+  return ind == _next ? -1 : ind;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Decode the event in the passed slot
+//
+void JournalClass::getEvent(int ind, struct journalEvent_t *ev) {
+  uint8_t code = EEPROM.read(JOURNAL_START + ind*3);
+
+  ev->code = (code >> 3) & 0x0f;
+  ev->arg = code & 0x07;
+  ev->data = ((uint16_t)EEPROM.read(JOURNAL_START + ind*3 + 1) << 8) | EEPROM.read(JOURNAL_START + ind*3 + 2);
+
+  if ((ev->code == EV_TIME_HIGH) || (ev->code == EV_TIME_LOW))
+    ev->delta = 0;
+  else if (ev->data & 0x8000)
+    ev->delta = (uint32_t)(ev->data & 0x7fff) * 60;
+  else
+    ev->delta = ev->data;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getter for the name of the passed event code
+//
+void JournalClass::getEventName(uint8_t code, char *b) {
+  strcpy_P(b, eventName[code & 0x0f]);
+};
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
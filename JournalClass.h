@@ -0,0 +1,97 @@
+//
+// JournalClass.h
+//
+// Data definition and function prototype file for JournalClass.cpp, which
+// keeps a compact journal of the state changes leading up to (and out of) 
+// each outage in its own circular list in EEPROM
+//
+// Data Formats: Each event comprises 3 bytes
+//   Byte 0    : Bit 7 is the lap flag, which is flipped each time the list
+//               wraps around so that the end of the list can be found at
+//               power up.  Bits 6-3 are the event code, bits 2-0 are an
+//               argument for the event (eg the retry number)
+//   Bytes 1-2 : Time since the previous event, big endian.  If bit 15 is 
+//               clear the time is in seconds, otherwise it is in minutes.
+//               For the EV_TIME_HIGH and EV_TIME_LOW events, these bytes 
+//               are instead the high and low halves of the time in seconds
+//               since 1900, which anchors the times of the events after it
+//   0xFF 0xFF 0xFF is an unused slot
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS Failure simulation events carry the scenario number
+//
+//------------------------------------------------------------------------------
+#ifndef __JOURNAL_CLASS_H
+#define __JOURNAL_CLASS_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include "EEPROMRecordClass.h"
+
+// Event codes.  15 is reserved, since an unused slot reads as code 15
+#define EV_BOOT                 0   // Arduino powered up or reset
+#define EV_TIME_HIGH            1   // High half of a time anchor
+#define EV_TIME_LOW             2   // Low half of a time anchor
+#define EV_POLL_FAIL            3   // No response to a poll, arg is the retry number (only the first 7 are logged)
+#define EV_RESTART              4   // Modem power cycle started, arg is one of the RESTART_ reasons below
+#define EV_POWER_RESTORED       5   // Power reapplied to the modem
+#define EV_ONLINE               6   // Connection validated after power up or a modem power cycle
+#define EV_ARBITRATION_TIMEOUT  7   // Arbitration period passed without the modem coming online
+#define EV_LED_MODE             8   // Status LED manually changed, arg is the new OUTPUT_ mode
+#define EV_RELAY_MODE           9   // Relay manually changed, arg is the new OUTPUT_ mode
+#define EV_FAULT_SIM            10  // Failure simulation changed, arg is the scenario (0 when stopped)
+#define EV_KISS                 11  // Kiss-o'-Death received, arg is one of the KISS_ codes below
+#define EV_FALSETICKER          12  // Reply ignored because its time disagreed with the other servers
+#define EV_DHCP                 13  // Network settings changed, arg is 1 if they came from DHCP
+#define EV_LOG_CLEARED          14  // Outage log manually cleared
+
+// Arguments for EV_RESTART
+#define RESTART_RETRIES         0   // Retries exceeded with no reply history to judge by
+#define RESTART_SUSPICION       1   // Phi-accrual suspicion crossed the threshold
+#define RESTART_MAINTENANCE     2   // Planned restart of a degraded modem
+
+// Arguments for EV_KISS
+#define KISS_RATE               0
+#define KISS_DENY               1
+#define KISS_OTHER              2
+
+// A decoded event
+struct journalEvent_t {
+  uint8_t  code;
+  uint8_t  arg;
+  uint16_t data;      // Raw bytes 1-2
+  uint32_t delta;     // Seconds since the previous event (0 for the time anchors)
+};
+
+class JournalClass {
+  private:
+    static const uint8_t JOURNAL_SLOTS = JOURNAL_LENGTH / 3;
+    static const uint32_t ANCHOR_TIME = 24UL*60*60*1000; // Time in ms between time anchors
+
+    uint8_t  _next;           // Slot the next event will be written to
+    uint8_t  _lap;            // Lap flag for the next event (0x80 or 0)
+    uint32_t _lastMillis;     // millis() of the previous event, less any part second or minute not yet logged
+    bool     _anchored;       // true once a time anchor has been written since power up
+    uint32_t _anchorMillis;   // millis() at the last time anchor
+
+    void write(uint8_t, uint8_t, uint16_t);
+
+  public:
+    JournalClass();
+    void begin();
+    void log(uint8_t, uint8_t);
+    void setTime(uint32_t);
+    int getOldest();
+    int getNewest(uint8_t);
+    int getNext(int);
+    void getEvent(int, struct journalEvent_t *);
+    void getEventName(uint8_t, char *);
+}; // class JournalClass
+
+#endif
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
@@ -7,6 +7,12 @@
 //  Revision History
 //  ~~~~~~~~~~~~~~~~
 //    12 Oct 2024 MDS Original
+//    18 Oct 2026 MDS Cursor for paged outage history output
+//    18 Oct 2026 MDS Cursor for journal output
+//    18 Oct 2026 MDS Serial command table entry
+//    18 Oct 2026 MDS Outage history records sent in two parts
+//    18 Oct 2026 MDS Journal time only decoded from complete anchors, and events sent in two parts
+//    18 Oct 2026 MDS Counters since power up for the status line
 //
 //------------------------------------------------------------------------------
 
@@ -20,6 +26,50 @@ struct modemRecord_t {
   uint16_t waitSecs;            // How long have we been waiting after the last restart for the modem to come online ?
 };
 
+// Cursor for the outage history, which is sent out the serial port a record at a time from loop() so that
+// printing a long history doesn't hold up polling
+struct historyTask_t {
+  bool     active;              // true while records are being sent
+  bool     newestFirst;         // Order in which the records are being sent
+  int      index;               // EEPROM index of the next record to send, -1 at the end of the history
+  bool     timeSent;            // true once the time of the record at index has been sent, and its duration is next
+  uint16_t pageSize;            // Records per page, 0 for the whole history
+  uint16_t remaining;           // Records left to send on this page
+  uint16_t sent;                // Records sent since the history was started
+};
+
+// Where we are up to sending the state change journal out through the serial port
+struct journalTask_t {
+  bool     active;              // true while events are being sent
+  int      index;               // Journal slot of the next event to send, -1 at the end of the journal
+  bool     timeSent;            // true once the time of the event at index has been sent, and its name is next
+  bool     haveTime;            // true once a time anchor has been decoded
+  bool     haveBoot;            // true once a power up has been passed, so that the time since it is known
+  uint32_t secs;                // Time of the last event sent; seconds since 1900 if haveTime is true,
+                                // otherwise seconds since the last power up
+  bool     haveHigh;            // true if the last event was the high half of a time anchor
+  uint16_t timeHigh;            // High half of a time anchor, waiting for the low half
+};
+
+// Counts since power up, for the ? status line.  A monitoring script can work out rates from the change
+// between two queries
+struct statusCounters_t {
+  uint32_t polls;               // Polls sent, including retries
+  uint32_t failed;              // Polls that got no reply
+  uint16_t restarts;            // Modem power cycles, planned or not
+  uint16_t kisses;              // Kiss-o'-Death replies
+  uint16_t falsetickers;        // Replies whose time disagreed with the other servers
+  uint16_t dhcpFailures;        // DHCP attempts that got no answer
+};
+
+// Entry in the serial command table, which is kept in PROGMEM
+typedef void (*commandHandler_t)(uint16_t);
+struct command_t {
+  char             key;         // Upper case character that invokes the command
+  commandHandler_t handler;     // Carries out the command, passed the number typed in front of the key
+  const char      *help;        // Help menu text in PROGMEM, NULL to leave the command out of the menu
+};
+
 #endif
 
 //-----------------------------------------------------------------------------
@@ -32,6 +32,32 @@
 //  ~~~~~~~~~~~~~~~~
 //    12 Oct 2024 MDS Original
 //    10 Dec 2024 MDS Working version
+//    18 Oct 2026 MDS Phi-accrual failure detection replaces the fixed retry count
+//                    while the modem is online
+//    18 Oct 2026 MDS NTP server health persisted in EEPROM across restarts
+//    18 Oct 2026 MDS Planned modem restart in a maintenance window when the link degrades
+//    18 Oct 2026 MDS Outage history sent a record at a time, with paging and newest first options
+//    18 Oct 2026 MDS Sparse, changed-only and decoded EEPROM dump modes
+//    18 Oct 2026 MDS Kiss-o'-Death replies and server back off don't count as failures
+//    18 Oct 2026 MDS Outage times only taken from replies that agree with the other servers
+//    18 Oct 2026 MDS DHCP, starting from the cached lease and confirming it in the background
+//    18 Oct 2026 MDS State change journal in EEPROM, with a J command to decode it
+//    18 Oct 2026 MDS ? command answers with a single key=value line for monitoring scripts
+//    18 Oct 2026 MDS Modem power off time kept by a TIMER2 one-shot rather than loop()
+//    18 Oct 2026 MDS Serial commands in a table in flash, with the help menu built from it
+//    18 Oct 2026 MDS Outcome of the last 512 polls kept in RAM, and drawn by the G command
+//    18 Oct 2026 MDS Non-blocking fault injection scenarios replace the simulated timeout
+//    18 Oct 2026 MDS Outage records sent in two parts so that each fits in the serial transmit buffer
+//    18 Oct 2026 MDS First time after power up only used once a second server agrees with it
+//    18 Oct 2026 MDS DHCP retried while polls fail, and after every modem power cycle
+//    18 Oct 2026 MDS Journal times only decoded from complete anchors or since a power up
+//    18 Oct 2026 MDS Simulated reply loss applied by NTPClass
+//    18 Oct 2026 MDS NTP server health first saved after the first reply rather than 4 hours after power up
+//    18 Oct 2026 MDS Planned maintenance restarts kept out of the outage log
+//    18 Oct 2026 MDS Kiss-o'-Death keeps the link alive without skewing the reply intervals
+//    18 Oct 2026 MDS Falseticker and provisional replies likewise
+//    18 Oct 2026 MDS Status line carries counts of polls, failures, restarts and so on since power up
+//    18 Oct 2026 MDS Simulated link failure goes through the normal server pacing
 //
 //------------------------------------------------------------------------------
 #include <SPI.h>     
@@ -39,16 +65,41 @@
 #include "ModemMonitor.h"
 #include "EEPROMRecordClass.h"
 #include "NTPClass.h"
+#include "FailureDetectorClass.h"
+#include "TrendMonitorClass.h"
+#include "DHCPLeaseClass.h"
+#include "JournalClass.h"
+#include "ProbeHistoryClass.h"
+#include "FaultInjectionClass.h"
 
 const uint32_t BAUD_RATE = 115200;           // Serial port baud rate
 
+const bool USE_DHCP = true;                  // Get the network settings by DHCP. If false, or if there is no 
+                                             // cached lease and the DHCP server doesn't answer at power up, the
+                                             // settings hard coded in setup() are used
+
 const uint16_t NTP_SERVER_POLL_TIME = 40000; // Normal polling interval in ms
 const int8_t POLL_NO_RESPONSE = -1;
 const int8_t POLL_SUCCESS = 0;
+const int8_t POLL_KISS_OF_DEATH = 1;         // Server replied, but refused to give us the time
+const int8_t POLL_DEFERRED = 2;              // Every server is waiting out its minimum poll interval
+const uint16_t POLL_DEFERRED_TIME = 1000;    // Time in ms before checking again after POLL_DEFERRED
+const int8_t POLL_FALSETICKER = 3;           // Server replied, but its time disagrees with the other servers
+const int8_t POLL_PROVISIONAL = 4;           // Server replied, but we have no time yet and no other server has
+                                             // confirmed its time
+const uint16_t SIMULATED_RETRY_TIME = 1000;  // Time in ms between retries while the link is simulated down.  The
+                                             // simulated DNS lookups fail at once, where real ones wait out a
+                                             // timeout
 
 const uint8_t MODEM_ARBITRATION_TIME = 15;   // Time in minutes in which the modem would be guaranteed to
                                              // successfully arbitrate with a functional external network
 
+// A degraded modem is restarted in this window of local time, when nobody should be using the internet
+const uint8_t MAINTENANCE_START_HOUR = 3;    // Window starts at 0300
+const uint8_t MAINTENANCE_END_HOUR = 4;      // Window ends at 0400
+const uint32_t MIN_MAINTENANCE_INTERVAL = 20UL*60*60*1000; // Modem must have been up this long in ms before a
+                                                           // planned restart, so we restart at most once a night
+
 // Pin assignments
 // Notes 
 //   - Can't use PB5, (used by the inbuilt LED on the Uno board) because this is used for the SCK for the ethernet shield
@@ -69,9 +120,13 @@ const uint8_t  relayPin = 3;     // PD3 - The N/C relay switching modem power
                                  //     - Ethernet shield DIGITAL header terminal 3 (fourth terminal)
 
 uint8_t  retryNo = 0;            // Number of times that we have tried to ping and failed
-const uint8_t   MAX_RETRIES = 3; // Number of failed polls before resetting modem under normal conditions. 
+const uint8_t   MAX_RETRIES = 3; // Number of failed polls before resetting modem when we have no reply history
+                                 // to judge by (ie after power up or after the arbitration period).
                                  // We keep this low because the DNS Client library has three retries hard
                                  // coded every time we try to resolve the NTP server URL into an IP address
+const float PHI_THRESHOLD = 8.0; // Suspicion level at which an online modem is power cycled. Each unit is a
+                                 // factor of 10 less likely that the link is still up (8 => 1 in 10^8)
+uint8_t  suspicion = 0;          // Latest phi as a percentage of PHI_THRESHOLD (used for the status LED)
 
 
 // Flash on times for the status LED in ms.  All flashing has a 50% duty cycle
@@ -81,14 +136,15 @@ const unsigned int FAST_FLASH   = 80;   // Retries exceeded, time to reboot the
 
 // Timing variables
 uint32_t currentMillis;
-uint32_t previousRelayMillis;            // Timing variable for powering down the relay
+volatile uint16_t relayTicks = 0;        // TIMER2 ticks left until power is reapplied to the modem
+volatile bool relayPulseDone = false;    // Set by the TIMER2 interrupt when the modem power off time is over
 uint16_t pollDelayMillis =  1;           // Remembers the delay between NTP server polls.  A value of 1 signals the first pass through loop()
 
 // State machine for the modem
 const uint8_t S_ARDUINO_POWERUP          = 0; // We have just powered up the Arduino and are looking for the first modem response
 const uint8_t S_LOOKING_FOR_MODEM_ONLINE = 1; // We are looking for a connection to the ISP after modem restart (modem is arbitrating)
 const uint8_t S_MODEM_IS_ONLINE          = 2; // We have successfully pinged, and 
-const uint8_t S_MODEM_RESTART            = 3; // Modem has been online, but MAX_RETRIES have been exceeded so we are powering down the modem
+const uint8_t S_MODEM_RESTART            = 3; // Modem has been online, but has stopped responding so we are powering down the modem
 uint8_t state = S_ARDUINO_POWERUP;
 
 // States for the outputs (which can be manually overridden)
@@ -97,18 +153,44 @@ const uint8_t OUTPUT_OFF     = 1;
 const uint8_t OUTPUT_DEFAULT = 2;
 
 const uint16_t MODEM_POWER_OFF_TIME = 3000; // Time which we hold the modem power off to do a hard reset in ms
+const uint8_t  RELAY_TICK_TIME = 4;         // TIMER2 tick in ms while timing the modem power off
+
+const uint8_t HISTORY_TX_SPACE = 40;        // Free space needed in the serial transmit buffer before the next
+                                            // part of an outage record is sent, so that sending it doesn't stall
+                                            // loop().  A whole record line (69 chars) is more than the 63 the
+                                            // Uno's buffer can hold, so the time (29 chars) and the duration
+                                            // (40 chars) are sent separately.  Journal events are sent the same
+                                            // way, in parts of up to 34 chars
+
+const uint32_t HEALTH_SAVE_TIME = 4UL*60*60*1000; // Interval between saves of the NTP server health to EEPROM in ms.
+                                                  // Two slots alternate, so each slot is written every 8 hours at most,
+                                                  // plus once after the first reply following each power up
+
+const uint8_t MAX_STATUS_OUTAGES = 16;      // Most outages that the ? command will add to its status line
 
 char buffer[200];
 
 struct modemRecord_t modem;        // Working record for modem uptime data
 EEPROMRecordClass m;               // Class which contains all of the stuff to work on the modem outage records in EEPROM
 NTPClass NTP;                      // This does all of the NTP stuff
+FailureDetectorClass detector;     // Decides when an online modem has stopped responding
+TrendMonitorClass trend;           // Decides when an online modem has degraded enough to restart it
+DHCPLeaseClass dhcp;               // Looks after our network settings when USE_DHCP is true
+JournalClass journal;              // Keeps the state changes leading up to each outage in EEPROM
+ProbeHistoryClass probes;          // Remembers whether each recent poll was answered, and how quickly
+FaultInjectionClass fault;         // Simulates internet faults for testing
 
 uint8_t verboseMode = false;           
 uint8_t statusLEDMode = OUTPUT_DEFAULT;
 uint8_t relayMode = OUTPUT_DEFAULT;
-uint8_t simulateNoResponse = false;    // Allows simulation of timeout when set to true
+bool maintenanceRestart = false;       // Set when a restart is planned rather than forced by an outage
+bool plannedRestart = false;           // Set from a planned restart until the modem is back online, so that the
+                                       // planned downtime doesn't go in the outage log
 bool clearEEPROMFlag = false;
+uint16_t commandArg = 0;               // Number typed in front of a serial command, eg 10S (0 if none)
+struct historyTask_t history;          // Where we are up to sending the outage history
+struct journalTask_t journalTask;      // Where we are up to sending the journal
+struct statusCounters_t counters;      // Counts since power up for the status line
 
 //
 //-----------------------------------------------------------------------------
@@ -141,14 +223,14 @@ ISR(TIMER1_COMPA_vect) {
       //
       //   Waiting for arbitration : SLOW_FLASH
       //   Normal ping : MEDIUM_FLASH (default case upon startup)
-      //   As retryNo expire : Increasing flash rate from MEDIUM_FLASH to FAST_FLASH
+      //   As suspicion rises : Increasing flash rate from MEDIUM_FLASH to FAST_FLASH
       //   Modem power out : FAST_FLASH
       if (state == S_MODEM_RESTART) {
         t = FAST_FLASH;
       } else if ((state == S_LOOKING_FOR_MODEM_ONLINE) || (state == S_ARDUINO_POWERUP)) {
         t = SLOW_FLASH;
       } else if (retryNo > 0) {
-        t = FAST_FLASH + ((MAX_RETRIES - retryNo) * (MEDIUM_FLASH - FAST_FLASH))/MAX_RETRIES;
+        t = FAST_FLASH + ((uint32_t)(100 - suspicion) * (MEDIUM_FLASH - FAST_FLASH))/100;
       } else {
         t = MEDIUM_FLASH; // Normal operation
       };
@@ -200,7 +282,7 @@ ISR(TIMER1_COMPB_vect) {
       mins = mins - 240;
 
     // Update the duration of the present outage
-    if ((retryNo > 0) || (state == S_LOOKING_FOR_MODEM_ONLINE) || (state == S_ARDUINO_POWERUP))
+    if (((retryNo > 0) || (state == S_LOOKING_FOR_MODEM_ONLINE) || (state == S_ARDUINO_POWERUP)) && !plannedRestart)
       modem.downMins++;
 
     // Record restart information to EEPROM every 15 minutes
@@ -212,6 +294,31 @@ ISR(TIMER1_COMPB_vect) {
   return;
 }
 
+//
+//-----------------------------------------------------------------------------
+// End the modem power off time
+// 
+// This TIMER2 Compare Interrupt A occurs every 4ms while the modem power is 
+// off, and not at all otherwise:
+//   Clock runs at 16MHz, prescaler is set to 256 which causes a tick every 16us
+//   In CTC mode the timer is cleared after 250 ticks (OCR2A = 249), which 
+//   equates to every 4ms
+//
+// Timing this here rather than in loop() means that a slow DNS lookup or a
+// burst of serial output can't stretch the time that the modem is without 
+// power.  loop() picks up relayPulseDone to move the state machine on.
+//
+ISR(TIMER2_COMPA_vect) {
+  if (--relayTicks > 0)
+    return;
+
+  TIMSK2 &= ~B00000010;  // One shot, so disable Timer COMPA Interrupt
+  if (relayMode == OUTPUT_DEFAULT)
+    digitalWrite(relayPin, LOW); // Reapply power to the modem
+  relayPulseDone = true;
+  return;
+}
+
 //
 //-----------------------------------------------------------------------------
 // setup()
@@ -221,15 +328,35 @@ void setup() {
 
   static const uint8_t mac[] = {0xDE, 0xAD, 0xBE, 0xEF, 0xFE, 0xED}; // MAC address for ethernet shield
 
-  IPAddress myIP(192,0,0,10);                        // IP address for my ethernet shield - Change this to suit your network
-  IPAddress gatewayIP(192, 0,  0, 1);                // The network's internal gateway address - Change this to siut your network
-  IPAddress dnsIP(220, 233,  0, 3);                  // The DNS address that the network uses (not used in this code except in initialisation)
-  IPAddress subnetMask(255, 255, 255, 0);            // The ethernet shield's subnet mask
-
-  Ethernet.begin(mac, myIP, dnsIP, gatewayIP, subnetMask);
-  NTP.begin(&dnsIP);
+  struct lease_t lease = {
+    {192,   0,   0,  10},                            // IP address for my ethernet shield - Change this to suit your network
+    {192,   0,   0,   1},                            // The network's internal gateway address - Change this to siut your network
+    {220, 233,   0,   3},                            // The DNS address that the network uses to resolve the NTP server URLs
+    {255, 255, 255,   0}                             // The ethernet shield's subnet mask
+  };
+  bool cached = false;
 
   Serial.begin(BAUD_RATE);
+  journal.begin();
+
+  if (USE_DHCP) {
+    // Start polling on the last lease if we have one, and confirm it with the DHCP server later
+    cached = (m.getCachedLease((uint8_t *)&lease, sizeof(lease)) == 0);
+    if (dhcp.begin((uint8_t *)mac, &lease, cached) == 0) {
+      dhcp.getLease(&lease);
+      m.setCachedLease((uint8_t *)&lease, sizeof(lease));
+    };
+    journal.log(EV_DHCP, dhcp.isFromDHCP());
+  } else {
+    Ethernet.begin(mac, IPAddress(lease.ip[0], lease.ip[1], lease.ip[2], lease.ip[3]),
+      IPAddress(lease.dns[0], lease.dns[1], lease.dns[2], lease.dns[3]),
+      IPAddress(lease.gateway[0], lease.gateway[1], lease.gateway[2], lease.gateway[3]),
+      IPAddress(lease.subnet[0], lease.subnet[1], lease.subnet[2], lease.subnet[3]));
+  };
+
+  IPAddress dnsIP = Ethernet.dnsServerIP();
+  NTP.begin(&dnsIP);
+  detector.begin(NTP_SERVER_POLL_TIME);
 
   pinMode(statusLEDPin, OUTPUT);
   pinMode(relayPin, OUTPUT);
@@ -249,30 +376,29 @@ void setup() {
   Serial.print(F(" at "));
   Serial.println(__TIME__);
 
-  Serial.print(F("\r\nEthernet hardware ready:                                               Serial Commands:\r\n"));
+  if (!USE_DHCP)
+    Serial.print(F("\r\nNetwork settings are hard coded\r\n"));
+  else if (dhcp.isFromDHCP())
+    Serial.print(F("\r\nNetwork settings are from DHCP\r\n"));
+  else if (cached)
+    Serial.print(F("\r\nNetwork settings are from the last DHCP lease (will be confirmed after the first poll)\r\n"));
+  else
+    Serial.print(F("\r\nNo answer from DHCP - network settings are hard coded until it answers\r\n"));
 
+  Serial.print(F("\r\nEthernet hardware ready:\r\n"));
   Serial.print(F("  My IP Address is "));
-  Serial.print(Ethernet.localIP());
-  Serial.print(F(                   "                                         C - Clear outage history (initialise EEPROM)\r\n"));
+  Serial.println(Ethernet.localIP());
   Serial.print(F("  Gateway IP Address is "));
-  Serial.print(Ethernet.gatewayIP());
-  Serial.print(F(                        "                                    D - Dump EEPROM contents to serial port\r\n"));
+  Serial.println(Ethernet.gatewayIP());
   Serial.print(F("  DNS Server IP Address is "));
-  Serial.print(Ethernet.dnsServerIP());
-  Serial.print(F(                         "                                   F - Simulate internet failure (ENABLE/DISABLE)\r\n"));
+  Serial.println(Ethernet.dnsServerIP());
   Serial.print(F("  Subnet mask is "));
-  Serial.print(Ethernet.subnetMask());
-  Serial.print(F(                 "                                           H - Show command options (help)\r\n"
-    "                                                                         L - Toggle external status LED (ON/OFF/Default)\r\n"
-    "Connected to serial port at "));
-  sprintf(buffer,
-    "%6lu", BAUD_RATE);
-  Serial.print(buffer);
-  Serial.print(F(                     " baud                                  R - Toggle output relay (ON/OFF/Default)\r\n"));
-  Serial.print(F(
-    "                                                                         S - Show outage history\r\n"));
-  Serial.print(F(
-    "                                                                         V - Toggle verbose mode (ON/OFF)\r\n"));
+  Serial.println(Ethernet.subnetMask());
+  Serial.print(F("Connected to serial port at "));
+  Serial.print(BAUD_RATE);
+  Serial.print(F(" baud\r\n"));
+
+  printHelp();
 
   Serial.print(F(
     "\r\nI'm gonna contact the following NTP Servers to check that I have internet connectivity:\r\n"));
@@ -282,6 +408,11 @@ void setup() {
   m.getEEPROMUptimeStats();
   m.convertFromEEPROMBlock(&modem);
 
+  // Start with the server that was answering best before we restarted
+  if (m.getTargetHealth((uint8_t *)NTP.health, sizeof(NTP.health)) == 0)
+    Serial.print(F("NTP server health restored from EEPROM\r\n"));
+  NTP.selectServer(0xff);
+
   digitalWrite(relayPin, LOW);
 
  // currentMillis = millis();
@@ -295,6 +426,13 @@ void setup() {
   OCR1A = 625;          // Timer 1 CompareA Register - this gives a compare interrupt every 40ms (625 x 64us)
   OCR1B = 15625;        // Timer 1 CompareB Register - this gives a compare interrupt every 1,000ms (15,625 x 64us)
   TIMSK1 |= B00000110;  // Enable Timer COMPA Interrupt and Timer COMPB Interrupt
+
+  // TIMER2 times the modem power off.  It runs all the time, but its interrupt is only enabled by 
+  // startRelayPulse().  This takes TIMER2 away from tone() and PWM on pins 3 and 11 (the relay on pin 3
+  // is only ever switched on and off)
+  TCCR2A = B00000010;   // CTC mode, no PWM outputs
+  TCCR2B = B00000110;   // Prescalar = 256. At a clock speed of 16MHz, this gives a tick rate of 16us per tick
+  OCR2A = 249;          // Timer 2 CompareA Register - this gives a compare interrupt every 4ms (250 x 16us)
   return;
 }  // setup()
 
@@ -305,10 +443,24 @@ void setup() {
 void loop() {
   static uint8_t powerUpFlag = true;            // Used to remember if we have we had a modem dropout since power up of the Arduino
   static int8_t pollResult;
+  static uint32_t healthSaveMillis = 0;
+  static bool healthSaved = false;              // true once the server health has been saved since power up
+  static uint32_t powerCycleMillis = 0;         // millis() when the modem was last power cycled (or we powered up)
+  float phi;
 
   currentMillis = millis();
 
   handleSerialInput();
+  serviceHistory();
+  serviceJournal();
+
+  if (fault.expired()) {
+    NTP.setLinkFault(false);
+    NTP.setDNSFault(false);
+    NTP.setReplyLoss(0);
+    Serial.print(F("\r\nSimulation of internet failure finished\r\n"));
+    journal.log(EV_FAULT_SIM, 0);
+  };
 
   // --------------------------------------------------------------------------
   // Do the poll if required
@@ -321,31 +473,84 @@ void loop() {
       Serial.print(buffer);
     };
 
-    if (simulateNoResponse != true) {
+    if (NTP.selectPollableServer()) {
       NTP.getPresentServer(buffer);  // Remember which server we are polling for the diagnostics after the poll
+      NTP.setLinkFault(fault.isLinkDown());
+      NTP.setDNSFault(fault.isDNSFailing());
+      NTP.setReplyLoss(fault.getReplyLoss());
       pollResult = NTP.getNTPTime();
-    } else {
-      strcpy_P(buffer, PSTR("simulated server"));
-      delay(3000); // Simulate waiting for response
-      pollResult = POLL_NO_RESPONSE;
-    }
+    } else
+      pollResult = POLL_DEFERRED;
 
     if (pollResult == POLL_SUCCESS) {
       pollDelayMillis = NTP_SERVER_POLL_TIME;
       modem.secsSince1900 = NTP.t.secsSince1900;
+      detector.heartbeat(millis());
+      trend.addSuccess(fault.adjustRTT(NTP.getRTT()));
+      probes.add(true, fault.adjustRTT(NTP.getRTT()));
+    } else if (pollResult == POLL_NO_RESPONSE) {
+      counters.failed++;
+      if ((state == S_MODEM_IS_ONLINE) && (retryNo == 0))
+        trend.addFailure(); // Scheduled poll lost (retries aren't counted)
+      probes.add(false, 0);
     };
 
-    clearLine();
-    if (pollResult == POLL_SUCCESS) {
+    if (pollResult != POLL_DEFERRED) {
+      clearLine();
+      counters.polls++;
+    };
+    if (pollResult == POLL_DEFERRED) {
+      // Nothing was sent, so this isn't a failure - just check again shortly
+      pollDelayMillis = POLL_DEFERRED_TIME;
+    } else if (pollResult == POLL_KISS_OF_DEATH) {
+      // The server answered so the link is up, but it gave us no time.  Its poll interval has been
+      // backed off, so try another server straight away
+      detector.alive(millis());
+      counters.kisses++;
+      Serial.print(F("Kiss-o'-Death "));
+      NTP.getKissCode(buffer + 30);
+      if (strcmp_P(buffer + 30, PSTR("RATE")) == 0)
+        journal.log(EV_KISS, KISS_RATE);
+      else if ((strcmp_P(buffer + 30, PSTR("DENY")) == 0) || (strcmp_P(buffer + 30, PSTR("RSTR")) == 0))
+        journal.log(EV_KISS, KISS_DENY);
+      else
+        journal.log(EV_KISS, KISS_OTHER);
+      Serial.print(buffer + 30);
+      Serial.print(F(" from "));
+      Serial.print(buffer);
+      Serial.print(F(" - backing off\r\n"));
+      pollDelayMillis = 2;
+    } else if (pollResult == POLL_FALSETICKER) {
+      // Likewise the link is up, but the time can't be trusted - don't let it near the outage log
+      detector.alive(millis());
+      counters.falsetickers++;
+      journal.log(EV_FALSETICKER, 0);
+      Serial.print(F("Time from "));
+      Serial.print(buffer);
+      Serial.print(F(" disagrees with the other servers - ignored\r\n"));
+      pollDelayMillis = 2;
+    } else if (pollResult == POLL_PROVISIONAL) {
+      // The link is up, but the first time since power up needs a second server to vouch for it
+      detector.alive(millis());
+      Serial.print(F("Time from "));
+      Serial.print(buffer);
+      Serial.print(F(" held until another server agrees with it\r\n"));
+      pollDelayMillis = 2;
+    } else if (pollResult == POLL_SUCCESS) {
       NTP.printTimeDateInfo();
       Serial.print(F(" "));
+      journal.setTime(NTP.getSecsSince1900());
       if ((state == S_LOOKING_FOR_MODEM_ONLINE) || (state == S_ARDUINO_POWERUP)) {
         Serial.print(F("Connection with the ISP node device has been validated\r\n"));
+        journal.log(EV_ONLINE, 0);
 
-        if (state != S_ARDUINO_POWERUP) {
+        if ((state != S_ARDUINO_POWERUP) && !plannedRestart) {
           m.convertToEEPROMBlock(&modem);
           m.completeLogEntry();
         };
+        if (state != S_ARDUINO_POWERUP)
+          dhcp.confirm(); // In case the attempt after the power cycle was made before the modem was ready
+        plannedRestart = false;
       } else {
         Serial.print(F("Poll success"));
       };
@@ -354,6 +559,15 @@ void loop() {
       pollDelayMillis = NTP_SERVER_POLL_TIME;
       modem.downMins = 0;
       retryNo = 0;
+      suspicion = 0;
+
+      // Restart a degraded modem in the maintenance window rather than wait for it to fail during the day
+      if ((NTP.t.hour >= MAINTENANCE_START_HOUR) && (NTP.t.hour < MAINTENANCE_END_HOUR) &&
+          (millis() - powerCycleMillis >= MIN_MAINTENANCE_INTERVAL) && trend.isDegraded()) {
+        journal.log(EV_RESTART, RESTART_MAINTENANCE);
+        maintenanceRestart = true;
+        state = S_MODEM_RESTART;
+      };
     } else {
       Serial.print(F("No response from "));
       Serial.print(buffer);
@@ -362,32 +576,51 @@ void loop() {
       // Also allow retryNo after the autonegotiation should have finished (in case the network goes 
       // down for some time before becoming available - this will reforce power reboot)
       if ((state == S_MODEM_IS_ONLINE) || (modem.waitSecs/60 >= MODEM_ARBITRATION_TIME)) {
+        if ((state != S_MODEM_IS_ONLINE) && (retryNo == 0)) {
+          journal.log(EV_ARBITRATION_TIMEOUT, 0);
+          plannedRestart = false; // The modem should be back by now, so from here on this is an outage
+        };
         retryNo++;
+        if (retryNo <= 7)
+          journal.log(EV_POLL_FAIL, retryNo); // Further retries are taken as read, rather than filling the journal
         pollDelayMillis = 2; // Retry time is hard coded in Dns.h which resolves the URL to an IP address, so make our one tiny
+        if (fault.isLinkDown())
+          pollDelayMillis = SIMULATED_RETRY_TIME;
       }
 
       if ((state == S_LOOKING_FOR_MODEM_ONLINE) && (modem.waitSecs/60 < MODEM_ARBITRATION_TIME))
         pollDelayMillis = NTP_SERVER_POLL_TIME;
 
-      if (retryNo > MAX_RETRIES) {
+      // Once the modem is online, restart when the silence has become too unlikely for the link's
+      // normal reply pattern.  Before that we have no pattern, so fall back to counting retries
+      phi = detector.getPhi(millis());
+      suspicion = phi >= PHI_THRESHOLD ? 100 : (uint8_t)(phi * 100 / PHI_THRESHOLD);
+
+      if (((state == S_MODEM_IS_ONLINE) && (retryNo > 0) && (phi >= PHI_THRESHOLD)) ||
+          ((state != S_MODEM_IS_ONLINE) && (retryNo > MAX_RETRIES))) {
+        journal.log(EV_RESTART, state == S_MODEM_IS_ONLINE ? RESTART_SUSPICION : RESTART_RETRIES);
         state = S_MODEM_RESTART;
-        previousRelayMillis = currentMillis; // Reset the modem power OFF timer
       } else {
         clearLine();
-        if (simulateNoResponse != true) {
-          Serial.print(F("Polling "));
-          NTP.getPresentServer(buffer);
-        } else
-          strcpy_P(buffer, PSTR("Simulation of server polling will happen"));
+        Serial.print(F("Polling "));
+        NTP.getPresentServer(buffer);
         Serial.print(buffer);
 
-        if (pollDelayMillis > 10) {
-          // This is not a retry, since retry poll time == 2
+        if (pollDelayMillis == NTP_SERVER_POLL_TIME) {
+          // This is not a retry
           Serial.print(F(" at "));
           Serial.print(((float)pollDelayMillis/1000), 0);
           Serial.print(F(" second intervals"));
         }
-        if ((state == S_MODEM_IS_ONLINE) || (modem.waitSecs/60 >= MODEM_ARBITRATION_TIME)) {
+        if (state == S_MODEM_IS_ONLINE) {
+          Serial.print(F(" (retry "));
+          Serial.print(retryNo);
+          Serial.print(F(", suspicion "));
+          Serial.print(phi, 1);
+          Serial.print(F(" of "));
+          Serial.print(PHI_THRESHOLD, 1);
+          Serial.print(F(")\r\n"));
+        } else if (modem.waitSecs/60 >= MODEM_ARBITRATION_TIME) {
           Serial.print(F(" (retry "));
           Serial.print(retryNo);
           Serial.print(F(" of "));
@@ -400,69 +633,141 @@ void loop() {
         }
       }
     }
+
+    // Look after the DHCP lease whether or not the poll worked.  If we have no lease, or the one we
+    // have is stale, no poll can work until DHCP has answered.  A DHCP attempt is only made every
+    // DHCP_RETRY_TIME, or when a confirmation has been asked for, so failing polls aren't held up
+    if (USE_DHCP && (pollResult != POLL_DEFERRED))
+      serviceLease();
   }; // if ((currentMillis % pollDelayMillis == 0) && (state != S_MODEM_RESTART))
 
   // --------------------------------------------------------------------------
   // Hold power off the modem for a time if maximum retryNo have been exceeded
   if (state == S_MODEM_RESTART) {
 
-    if ((currentMillis - previousRelayMillis) <= MODEM_POWER_OFF_TIME) {
-      if (retryNo > 0) { // This forces a one shot of the below code block since retryNo is reset to zero inside
-        sprintf(buffer,"\r\n%d", MAX_RETRIES);
+    if ((retryNo > 0) || (maintenanceRestart == true)) { // This forces a one shot of the below code block since
+                                                         // retryNo and maintenanceRestart are reset inside
+      if (maintenanceRestart == true) {
+        Serial.print(F("\r\nLink has degraded (RTT "));
+        Serial.print(trend.getRecentRTT());
+        Serial.print(F("ms against "));
+        Serial.print(trend.getBaselineRTT());
+        Serial.print(F("ms when fresh, "));
+        Serial.print(trend.getRecentLoss());
+        Serial.print(F("% of polls lost) - planned restart in the maintenance window\r\n"));
+      } else {
+        sprintf(buffer,"\r\n%d", retryNo);
         Serial.print(buffer);
-        Serial.print(F(
-          " retries failed\r\n"
-          "\r\n"
-          "    *************************************\r\n"
-          "    *************************************\r\n"
-          "    *****                           *****\r\n"
-          "    *****    Power cycling modem    *****\r\n"));
-        retryNo = 0;
-        if (relayMode == OUTPUT_OFF)
-          Serial.print(F("Unable to switch relay - it has been forced off\r\n"));
-        powerUpFlag = false;
-      };
-      // Reset modem by removing power (ie energising the relay to open the N/C contacts)
-      switch (relayMode) {
-        case OUTPUT_OFF:
-          break;
-        case OUTPUT_ON:
-        default:
-          digitalWrite(relayPin, HIGH);
-          break;
-      };
-    } else {
-      switch (relayMode) {
-        case OUTPUT_ON:
-          break;
-        case OUTPUT_OFF:
-          break;
-        default:
-          switchRelayOff();
-          state = S_LOOKING_FOR_MODEM_ONLINE;
-          modem.waitSecs = 0;
-          break;
+        Serial.print(F(" retries failed\r\n"));
       };
+      Serial.print(F(
+        "\r\n"
+        "    *************************************\r\n"
+        "    *************************************\r\n"
+        "    *****                           *****\r\n"
+        "    *****    Power cycling modem    *****\r\n"));
+      plannedRestart = maintenanceRestart;
+      counters.restarts++;
+      retryNo = 0;
+      suspicion = 0;
+      maintenanceRestart = false;
+      detector.restart(); // The outage and arbitration aren't a normal reply interval
+      trend.restart();    // Learn a new baseline from the fresh modem
+      powerCycleMillis = currentMillis;
+      if (relayMode == OUTPUT_OFF)
+        Serial.print(F("Unable to switch relay - it has been forced off\r\n"));
+      powerUpFlag = false;
+      startRelayPulse();
+    };
+
+    // The relay forced on holds the modem off for as long as it stays forced on
+    if (relayMode == OUTPUT_ON)
+      digitalWrite(relayPin, HIGH);
+
+    // Power has been reapplied by the TIMER2 interrupt (or will be by switchRelayOff() if the relay has 
+    // just been set back to default), so wait for the modem to come back
+    if ((relayPulseDone == true) && (relayMode == OUTPUT_DEFAULT)) {
+      relayPulseDone = false;
+      switchRelayOff();
+      journal.log(EV_POWER_RESTORED, 0);
+      state = S_LOOKING_FOR_MODEM_ONLINE;
+      modem.waitSecs = 0;
+      dhcp.confirm(); // The modem may have forgotten our lease, or moved us to a new subnet
     };
-  } else {
-    previousRelayMillis = currentMillis;
   };
 
-  // Handle rollover - this is not correct but near enough for what we are doing
-  if (currentMillis < previousRelayMillis)
-    previousRelayMillis = 0;
+  // --------------------------------------------------------------------------
+  // Remember which NTP servers are healthy in case we are restarted.  The first save is made as soon as
+  // a time has been accepted, so that a unit which loses power more often than every HEALTH_SAVE_TIME
+  // still keeps what it learns about the servers at power up
+  if (((healthSaved != true) && (NTP.getSecsSince1900() != 0)) ||
+      (healthSaved && (millis() - healthSaveMillis >= HEALTH_SAVE_TIME))) {
+    m.setTargetHealth((uint8_t *)NTP.health, sizeof(NTP.health));
+    healthSaveMillis = millis();
+    healthSaved = true;
+  };
 
   return;
 }  // loop()
 
+//
+// --------------------------------------------------------------------------
+// Serial commands
+//
+// Each command is a key, the function that carries it out and its line in
+// the help menu (NULL for a command which isn't shown, eg the Y that confirms
+// C).  The function is passed the number typed in front of the key, eg 10 for
+// 10S, or 0 if there wasn't one.  The table and the help text live in flash.
+//
+const char helpC[] PROGMEM = "Clear outage history (initialise EEPROM)";
+const char helpD[] PROGMEM = "Dump EEPROM contents to serial port (1D unused rows skipped, 2D changed rows, 3D decoded)";
+const char helpF[] PROGMEM = "Simulate internet failure (F toggles link down, nF runs scenario n, 99F lists them)";
+const char helpG[] PROGMEM = "Graph the outcome of the last 512 polls, with recent loss";
+const char helpH[] PROGMEM = "Display this menu";
+const char helpJ[] PROGMEM = "Show state change journal (nJ for the last n events)";
+const char helpL[] PROGMEM = "Toggle external status LED (ON/OFF/Default)";
+const char helpN[] PROGMEM = "Show outage history, newest first (nN for n per page)";
+const char helpP[] PROGMEM = "Show next page of outage history";
+const char helpR[] PROGMEM = "Toggle output relay (ON/OFF/Default)";
+const char helpS[] PROGMEM = "Show outage history (nS for n per page)";
+const char helpV[] PROGMEM = "Toggle verbose mode (ON/OFF)";
+const char helpQ[] PROGMEM = "Status as a single line of key=value pairs for scripts (n? adds the last n outages)";
+
+const struct command_t commands[] PROGMEM = {
+  {'C', cmdClearLog,        helpC},
+  {'D', cmdDumpEEPROM,      helpD},
+  {'F', cmdSimulateFailure, helpF},
+  {'G', cmdProbeHistory,    helpG},
+  {'H', cmdHelp,            helpH},
+  {'J', cmdJournal,         helpJ},
+  {'L', cmdStatusLED,       helpL},
+  {'N', cmdHistoryNewest,   helpN},
+  {'P', cmdNextPage,        helpP},
+  {'R', cmdRelay,           helpR},
+  {'S', cmdHistory,         helpS},
+  {'V', cmdVerbose,         helpV},
+  {'Y', cmdConfirmClearLog, NULL},
+  {'?', cmdStatusLine,      helpQ}
+};
+const uint8_t NUM_COMMANDS = sizeof(commands) / sizeof(commands[0]);
+
 //
 // --------------------------------------------------------------------------
 // Service any serial input
 void handleSerialInput() {
+  uint8_t i;
+  commandHandler_t handler;
 
   while (Serial.available() > 0) {
     uint8_t ch = toUpperCase(Serial.read());
 
+    // Digits are collected as the argument for the command that follows them
+    if ((ch >= '0') && (ch <= '9') && (clearEEPROMFlag != true)) {
+      if (commandArg < 1000)
+        commandArg = (commandArg * 10) + (ch - '0');
+      continue;
+    };
+
     if ((clearEEPROMFlag == true) && (ch != 'Y')) {
       // User responded with something other than 'Y' to the clear EEPROM confirmation
       Serial.print(F(
@@ -471,164 +776,646 @@ void handleSerialInput() {
         "Aborted\r\n"));
       clearEEPROMFlag = false;
     } else {
-      switch (ch) {
-        // Clear uptime history - writes the EEPROM with 255's
-        case 'C':
-          Serial.print(F(
-            "\r\n"
-            "\r\n"
-            "ALL OUTAGE DATA WILL BE DELETED. DO YOU WANT TO CONTINUE ? "));
-          clearEEPROMFlag = true;
+      for (i = 0; i < NUM_COMMANDS; i++) {
+        if (pgm_read_byte(&commands[i].key) == ch) {
+          handler = (commandHandler_t)pgm_read_word(&commands[i].handler);
+          handler(commandArg);
           break;
+        };
+      };
+    };
+    commandArg = 0;
+  };
+  return;
+};
 
-        // Dump EEPROM content to serial port
-        case 'D':
-          m.dumpEEPROM();
-          Serial.print(F(
-            "\r\n"
-            "\r\n"
-            "Software has been running since ")) ;
-          Serial.print(__DATE__);
-          Serial.print(F(" at "));
-          Serial.println(__TIME__);
-          break;
+//
+//-----------------------------------------------------------------------------
+// Send the help menu out through the serial port, built from the command 
+// table
+//
+void printHelp() {
+  uint8_t i;
+  const char *help;
 
-        // Toggle the simulation of timeout of the remote IP address
-        case 'F':
-          Serial.print(F(
-            "\r\n"
-            "Simulation of internet failure "));
-          if (simulateNoResponse == true) {
-            simulateNoResponse = false;
-            Serial.print(F("disabled"));
-          } else {
-            simulateNoResponse = true;
-            Serial.print(F("enabled"));
-          };
-          Serial.print(F("\r\n"));
-          break;
+  Serial.print(F(
+    "\r\n"
+    "\r\n"
+    "  Help Menu\r\n"
+    "  ~~~~~~~~~\r\n"));
+  for (i = 0; i < NUM_COMMANDS; i++) {
+    help = (const char *)pgm_read_word(&commands[i].help);
+    if (help == NULL)
+      continue;
+    Serial.print(F("  "));
+    Serial.print((char)pgm_read_byte(&commands[i].key));
+    Serial.print(F(" - "));
+    Serial.print((const __FlashStringHelper *)help);
+    Serial.print(F("\r\n"));
+  };
+  Serial.print(F("\r\n"));
+  return;
+};
 
-        case 'H':
-          Serial.print(F(
-            "\r\n"
-            "\r\n"
-            "  Help Menu\r\n"
-            "  ~~~~~~~~~\r\n"
-            "  C - Clear outage history (initialise EEPROM)\r\n"
-            "  D - Dump EEPROM contents to serial port\r\n"
-            "  F - Simulate internet failure (ENABLE/DISABLE)\r\n"
-            "  H - Display this menu\r\n"
-            "  L - Toggle external status LED (ON/OFF/Default)\r\n"
-            "  R - Toggle output relay (ON/OFF/Default)\r\n"
-            "  S - Show outage history\r\n"
-            "  V - Toggle verbose mode (ON/OFF)\r\n"
-            "\r\n"));
-          break;
+//
+//-----------------------------------------------------------------------------
+// Clear uptime history - asks for confirmation, then Y writes the log area of
+// the EEPROM with 255's
+//
+void cmdClearLog(uint16_t arg) {
+  Serial.print(F(
+    "\r\n"
+    "\r\n"
+    "ALL OUTAGE DATA WILL BE DELETED. DO YOU WANT TO CONTINUE ? "));
+  clearEEPROMFlag = true;
+  return;
+};
 
-        // Toggle the state of the external status LED
-        case 'L':
-          Serial.print(F("\r\n"));
-          switch (statusLEDMode) {
-            case OUTPUT_ON:
-              statusLEDMode = OUTPUT_OFF;
-              if (verboseMode == true)
-                Serial.print(F("Status LED turned off\r\n"));
-              break;
-            case OUTPUT_OFF:
-              statusLEDMode = OUTPUT_DEFAULT;
-              if (verboseMode == true)
-                Serial.print(F("Status LED reset to default\r\n"));
-              break;
-            default: // default case is OUTPUT_DEFAULT
-              statusLEDMode = OUTPUT_ON;
-              if (verboseMode == true)
-                Serial.print(F("Status LED turned on\r\n"));
-              break;
-          };
-          break;
+void cmdConfirmClearLog(uint16_t arg) {
+  if (clearEEPROMFlag == true) {
+    modem.downMins = 0;
+    m.convertToEEPROMBlock(&modem);
+    m.clearLog();
+    journal.log(EV_LOG_CLEARED, 0);
+    Serial.print(F(
+      "\r\n" 
+      "Outage log has been cleared\r\n"));
+    clearEEPROMFlag = false;
+  };
+  return;
+};
 
-        // Toggle the state of the onboard LED
-        case 'R':
-          Serial.print(F("\r\n"));
-          switch (relayMode) {
-            case OUTPUT_ON:
-              relayMode = OUTPUT_OFF;
-              if (verboseMode == true)
-                Serial.print(F("Output relay turned off (modem energised)\r\n"));
-              Serial.print(F(
-                "    *************************************\r\n"
-                "    *************************************\r\n"));
-              switchRelayOff();
-              break;
-            case OUTPUT_OFF:
-              relayMode = OUTPUT_DEFAULT;
-              if (verboseMode == true)
-                Serial.print(F("Output relay reset to default\r\n"));
-              break;
-            default: // default case is OUTPUT_DEFAULT
-              relayMode = OUTPUT_ON;
-              if (verboseMode == true)
-                Serial.print(F("Output relay turned on (modem de-energised)\r\n"));
-              break;
-          };
-          break;
+//
+//-----------------------------------------------------------------------------
+// Dump EEPROM content to serial port - 1D skips unused rows, 2D shows only 
+// changed rows, 3D decodes records
+//
+void cmdDumpEEPROM(uint16_t arg) {
+  m.dumpEEPROM(arg <= DUMP_RECORDS ? arg : DUMP_ALL);
+  Serial.print(F(
+    "\r\n"
+    "\r\n"
+    "Software has been running since ")) ;
+  Serial.print(__DATE__);
+  Serial.print(F(" at "));
+  Serial.println(__TIME__);
+  return;
+};
 
-        // Show uptime/outage history - send info through Serial port in a formatted fashion
-        case 'S':
-          Serial.print(F(
-            "\r\n"
-            "\r\n"
-            "                        --- MODEM OUTAGE HISTORY ---\r\n"
-            "\r\n"));
-
-          if (m.getOldestCompletedRecord() != -1) {
-            Serial.print(F("  On:\r\n"));
-            dumpOutageRecord();
-            while (m.getNextCompletedRecord() != -1)
-              dumpOutageRecord();
-          } else {
-            Serial.print(F("  No outages to report\r\n"));
-          };
-
-          Serial.print(F(
-            "\r\n"
-            "                           --- End Of History ---\r\n"
-            "\r\n"
-            "Software has been running since "));
-          Serial.print(__DATE__);
-          Serial.print(F(" at "));
-          Serial.println(__TIME__);
-          break;
+//
+//-----------------------------------------------------------------------------
+// Simulate internet failure.  F on its own toggles the link being down, nF
+// starts scenario n (replacing any that is running), and an n with no 
+// scenario lists them
+//
+void cmdSimulateFailure(uint16_t arg) {
+  uint8_t i;
 
-        // Toggle verbose mode
-        case 'V':
-          Serial.print(F(
-            "\r\n"
-            "Verbose mode turned "));
-          if (verboseMode == true) {
-            verboseMode = false;
-            Serial.print(F("off"));
-          } else {
-            verboseMode = true;
-            Serial.print(F("on"));
-          };
-          Serial.print(F("\r\n"));
-          break;
-        case 'Y':
-          if (clearEEPROMFlag == true) {
-            modem.downMins = 0;
-            m.convertToEEPROMBlock(&modem);
-            m.clearLog();
-            Serial.print(F(
-              "\r\n" 
-              "Outage log has been cleared\r\n"));
-            clearEEPROMFlag = false;
-          };
-          break;
-        default:
-          break;
-      }; // switch (ch)
+  Serial.print(F("\r\n"));
+  if ((arg == 0) && (fault.getScenario() != 0)) {
+    fault.stop();
+    NTP.setLinkFault(false);
+    NTP.setDNSFault(false);
+    NTP.setReplyLoss(0);
+    Serial.print(F("Simulation of internet failure disabled\r\n"));
+  } else if ((arg <= fault.getNumScenarios()) && fault.start(arg == 0 ? 1 : arg)) {
+    Serial.print(F("Simulation of internet failure enabled - "));
+    fault.getScenarioName(fault.getScenario(), buffer);
+    Serial.print(buffer);
+    Serial.print(F("\r\n"));
+  } else {
+    Serial.print(F("Internet failure scenarios:\r\n"));
+    for (i = 1; i <= fault.getNumScenarios(); i++) {
+      fault.getScenarioName(i, buffer);
+      Serial.print(F("  "));
+      Serial.print(i);
+      Serial.print(F("F - "));
+      Serial.print(buffer);
+      Serial.print(F("\r\n"));
     };
+    return;
+  };
+  journal.log(EV_FAULT_SIM, fault.getScenario() > 7 ? 7 : fault.getScenario());
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Show what the recent polls looked like, even if no outage has completed
+//
+void cmdProbeHistory(uint16_t arg) {
+  Serial.print(F(
+    "\r\n"
+    "\r\n"
+    "                          --- RECENT POLLS ---\r\n"
+    "\r\n"
+    "  Oldest on the left.  Loss is 8 polls a character, from _ (none lost) to @ (all lost)\r\n"
+    "  RTT is 4 polls a character, slowest of _ (<20ms), - (<50ms), = (<100ms), ^, or ! if all lost\r\n"
+    "\r\n"));
+  probes.printSparklines();
+
+  Serial.print(F("\r\n  Lost "));
+  Serial.print(probes.getLoss(32));
+  Serial.print(F("% of the last 32, "));
+  Serial.print(probes.getLoss(128));
+  Serial.print(F("% of the last 128 and "));
+  Serial.print(probes.getLoss(PROBE_HISTORY_LENGTH));
+  Serial.print(F("% of the last "));
+  Serial.print(probes.getCount());
+  Serial.print(F(" polls\r\n"));
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Display the help menu
+//
+void cmdHelp(uint16_t arg) {
+  printHelp();
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Show the state change journal, oldest event first.  nJ shows only the last 
+// n events.  The events themselves are sent by serviceJournal()
+//
+void cmdJournal(uint16_t arg) {
+  Serial.print(F(
+    "\r\n"
+    "\r\n"
+    "                       --- STATE CHANGE JOURNAL ---\r\n"
+    "\r\n"));
+  if (arg > 0)
+    journalTask.index = journal.getNewest(arg > 255 ? 255 : arg);
+  else
+    journalTask.index = journal.getOldest();
+  journalTask.timeSent = false;
+  journalTask.haveTime = false;
+  journalTask.haveBoot = false;
+  journalTask.haveHigh = false;
+  journalTask.secs = 0;
+  journalTask.active = (journalTask.index != -1);
+  if (journalTask.active != true)
+    endJournal();
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Toggle the state of the external status LED
+//
+void cmdStatusLED(uint16_t arg) {
+  Serial.print(F("\r\n"));
+  switch (statusLEDMode) {
+    case OUTPUT_ON:
+      statusLEDMode = OUTPUT_OFF;
+      if (verboseMode == true)
+        Serial.print(F("Status LED turned off\r\n"));
+      break;
+    case OUTPUT_OFF:
+      statusLEDMode = OUTPUT_DEFAULT;
+      if (verboseMode == true)
+        Serial.print(F("Status LED reset to default\r\n"));
+      break;
+    default: // default case is OUTPUT_DEFAULT
+      statusLEDMode = OUTPUT_ON;
+      if (verboseMode == true)
+        Serial.print(F("Status LED turned on\r\n"));
+      break;
+  };
+  journal.log(EV_LED_MODE, statusLEDMode);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Toggle the state of the output relay
+//
+void cmdRelay(uint16_t arg) {
+  Serial.print(F("\r\n"));
+  switch (relayMode) {
+    case OUTPUT_ON:
+      relayMode = OUTPUT_OFF;
+      if (verboseMode == true)
+        Serial.print(F("Output relay turned off (modem energised)\r\n"));
+      Serial.print(F(
+        "    *************************************\r\n"
+        "    *************************************\r\n"));
+      switchRelayOff();
+      break;
+    case OUTPUT_OFF:
+      relayMode = OUTPUT_DEFAULT;
+      if (verboseMode == true)
+        Serial.print(F("Output relay reset to default\r\n"));
+      break;
+    default: // default case is OUTPUT_DEFAULT
+      relayMode = OUTPUT_ON;
+      if (verboseMode == true)
+        Serial.print(F("Output relay turned on (modem de-energised)\r\n"));
+      break;
+  };
+  journal.log(EV_RELAY_MODE, relayMode);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Show uptime/outage history - send info through Serial port in a formatted 
+// fashion, oldest (S) or newest (N) first, arg records per page.  The records
+// themselves are sent by serviceHistory()
+//
+void cmdHistory(uint16_t arg) {
+  startHistory(false, arg);
+  return;
+};
+
+void cmdHistoryNewest(uint16_t arg) {
+  startHistory(true, arg);
+  return;
+};
+
+void startHistory(bool newestFirst, uint16_t pageSize) {
+  history.newestFirst = newestFirst;
+  history.pageSize = pageSize;
+  history.sent = 0;
+  history.timeSent = false;
+  Serial.print(F(
+    "\r\n"
+    "\r\n"
+    "                        --- MODEM OUTAGE HISTORY ---\r\n"
+    "\r\n"));
+
+  if (history.newestFirst) {
+    history.index = m.findRecordInProgress();
+    if (history.index >= 0)
+      history.index = m.getIndexOfPrevCompletedRecord(history.index);
+  } else {
+    history.index = m.findOldestCompletedRecord();
+  };
+
+  if (history.index != -1) {
+    Serial.print(F("  On:\r\n"));
+    history.remaining = history.pageSize;
+    history.active = true;
+  } else {
+    Serial.print(F("  No outages to report\r\n"));
+    endHistory();
+  };
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Show the next page of the outage history, optionally changing the page size
+//
+void cmdNextPage(uint16_t arg) {
+  if ((history.index == -1) || (history.sent == 0)) {
+    Serial.print(F("\r\nNo more outage history - use S or N to start again\r\n"));
+  } else {
+    if (arg > 0)
+      history.pageSize = arg;
+    history.remaining = history.pageSize;
+    history.active = true;
+  };
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Toggle verbose mode
+//
+void cmdVerbose(uint16_t arg) {
+  Serial.print(F(
+    "\r\n"
+    "Verbose mode turned "));
+  if (verboseMode == true) {
+    verboseMode = false;
+    Serial.print(F("off"));
+  } else {
+    verboseMode = true;
+    Serial.print(F("on"));
+  };
+  Serial.print(F("\r\n"));
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Everything a monitoring script needs on one line - n? adds the last n 
+// outages
+//
+void cmdStatusLine(uint16_t arg) {
+  printStatusLine(arg > MAX_STATUS_OUTAGES ? MAX_STATUS_OUTAGES : arg);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Send the next part of an outage record if the outage history is being shown
+// and there is room in the serial transmit buffer.  Called every time through
+// loop() so that a long history doesn't hold up polling or the relay timing.
+//
+void serviceHistory() {
+  int next;
+
+  if ((history.active != true) || (Serial.availableForWrite() < HISTORY_TX_SPACE))
+    return;
+
+  if (history.timeSent != true) {
+    dumpOutageTime(history.index);
+    history.timeSent = true;
+    return;
+  };
+
+  dumpOutageDuration(history.index);
+  history.timeSent = false;
+  history.sent++;
+
+  // Stop when we get back to where we started, in case the list is full of completed records
+  if (history.newestFirst)
+    next = m.getIndexOfPrevCompletedRecord(history.index);
+  else
+    next = m.getIndexOfNextCompletedRecord(history.index);
+  if (history.sent >= OUTAGE_LOG_LENGTH/8)
+    next = -1;
+  history.index = next;
+
+  if (history.index == -1) {
+    history.active = false;
+    endHistory();
+  } else if ((history.pageSize > 0) && (--history.remaining == 0)) {
+    history.active = false;
+    Serial.print(F("\r\n  --- P for the next page ---\r\n"));
+  };
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Footer for the outage history
+//
+void endHistory() {
+  Serial.print(F(
+    "\r\n"
+    "                           --- End Of History ---\r\n"
+    "\r\n"
+    "Software has been running since "));
+  Serial.print(__DATE__);
+  Serial.print(F(" at "));
+  Serial.println(__TIME__);
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Send the next part of a journal event if the journal is being shown and 
+// there is room in the serial transmit buffer.  Each event is sent as its time
+// and then its name, so that each part fits in the buffer.  Times are shown as
+// the date and time once a time anchor has been passed, and as the time since
+// power up before that.  Events before both, which the journal has lost the
+// start of, have no time we can show.
+//
+void serviceJournal() {
+  struct journalEvent_t ev;
+  struct NTPTime_t savedTime;
+
+  if ((journalTask.active != true) || (Serial.availableForWrite() < HISTORY_TX_SPACE))
+    return;
+
+  journal.getEvent(journalTask.index, &ev);
+
+  if (journalTask.timeSent != true) {
+    if (ev.code == EV_TIME_HIGH) {
+      journalTask.timeHigh = ev.data;
+      journalTask.haveHigh = true;
+    } else if (ev.code == EV_TIME_LOW) {
+      // The high half may have been overwritten, in which case this half is no use on its own
+      if (journalTask.haveHigh) {
+        journalTask.secs = ((uint32_t)journalTask.timeHigh << 16) | ev.data;
+        journalTask.haveTime = true;
+      };
+      journalTask.haveHigh = false;
+    } else {
+      // The time since the last event is lost when the Arduino is powered down
+      if (ev.code == EV_BOOT) {
+        journalTask.haveTime = false;
+        journalTask.haveBoot = true;
+        journalTask.secs = 0;
+      };
+      journalTask.haveHigh = false;
+      journalTask.secs += ev.delta;
+
+      Serial.print(F("    "));
+      if (journalTask.haveTime) {
+        savedTime = NTP.t;
+        NTP.t.secsSince1900 = journalTask.secs;
+        NTP.getYMDHMS();
+        NTP.printTimeDateInfo();
+        NTP.t = savedTime;
+      } else if (journalTask.haveBoot) {
+        sprintf(buffer, "     up %4lu:%02u:%02u", journalTask.secs/3600, (uint8_t)((journalTask.secs/60)%60), (uint8_t)(journalTask.secs%60));
+        Serial.print(buffer);
+      } else {
+        Serial.print(F("      time unknown"));
+      };
+      journalTask.timeSent = true;
+      return;
+    };
+  } else {
+    journalTask.timeSent = false;
+    Serial.print(F("  "));
+    journal.getEventName(ev.code, buffer);
+    Serial.print(buffer);
+
+    switch (ev.code) {
+      case EV_POLL_FAIL:
+        Serial.print(F(" (retry "));
+        Serial.print(ev.arg);
+        Serial.print(F(")"));
+        break;
+      case EV_RESTART:
+        Serial.print(ev.arg == RESTART_SUSPICION ? F(" (suspicion)") : 
+          ev.arg == RESTART_MAINTENANCE ? F(" (maintenance)") : F(" (retries)"));
+        break;
+      case EV_LED_MODE:
+      case EV_RELAY_MODE:
+        Serial.print(ev.arg == OUTPUT_ON ? F(" ON") : ev.arg == OUTPUT_OFF ? F(" OFF") : F(" to default"));
+        break;
+      case EV_FAULT_SIM:
+        if (ev.arg == 0) {
+          Serial.print(F(" stopped"));
+        } else {
+          Serial.print(F(" scenario "));
+          Serial.print(ev.arg);
+        };
+        break;
+      case EV_KISS:
+        Serial.print(ev.arg == KISS_RATE ? F(" (RATE)") : ev.arg == KISS_DENY ? F(" (DENY/RSTR)") : F(""));
+        break;
+      case EV_DHCP:
+        Serial.print(ev.arg ? F(" from DHCP") : F(" not from DHCP"));
+        break;
+      default:
+        break;
+    };
+    Serial.print(F("\r\n"));
+  };
+
+  journalTask.index = journal.getNext(journalTask.index);
+  if (journalTask.index == -1) {
+    journalTask.active = false;
+    endJournal();
+  };
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Footer for the journal
+//
+void endJournal() {
+  Serial.print(F(
+    "\r\n"
+    "                           --- End Of Journal ---\r\n"
+    "\r\n"));
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Send the state, counters and settings out through the serial port as one 
+// line of space separated key=value pairs, for monitoring scripts.  The line
+// starts with $MM and a version number, which will be bumped if the meaning
+// of an existing key changes (new keys may be added at any time).  The last
+// outageCount outages are added newest first as out=secsSince1900:downMins,...
+// The n... keys count since power up: polls sent, polls with no reply, modem
+// restarts, Kiss-o'-Death replies, falsetickers and unanswered DHCP attempts.
+//
+void printStatusLine(uint8_t outageCount) {
+  struct modemRecord_t mRec;
+  int ind;
+  uint8_t i;
+
+  Serial.print(F("\r\n$MM v=1 st="));
+  Serial.print(state);
+  Serial.print(F(" up="));
+  Serial.print(millis()/1000);
+  Serial.print(F(" t="));
+  Serial.print(NTP.getSecsSince1900());
+  Serial.print(F(" rty="));
+  Serial.print(retryNo);
+  Serial.print(F(" phi="));
+  Serial.print(detector.getPhi(millis()), 2);
+  Serial.print(F(" down="));
+  Serial.print(modem.downMins);
+  Serial.print(F(" wait="));
+  Serial.print(modem.waitSecs);
+
+  Serial.print(F(" npoll="));
+  Serial.print(counters.polls);
+  Serial.print(F(" nfail="));
+  Serial.print(counters.failed);
+  Serial.print(F(" nrst="));
+  Serial.print(counters.restarts);
+  Serial.print(F(" nkod="));
+  Serial.print(counters.kisses);
+  Serial.print(F(" nfts="));
+  Serial.print(counters.falsetickers);
+  Serial.print(F(" ndhcpf="));
+  Serial.print(counters.dhcpFailures);
+
+  NTP.getPresentServer(buffer);
+  Serial.print(F(" srv="));
+  Serial.print(buffer);
+  Serial.print(F(" rtt="));
+  Serial.print(NTP.getRTT());
+  Serial.print(F(" brtt="));
+  Serial.print(trend.getBaselineRTT());
+  Serial.print(F(" artt="));
+  Serial.print(trend.getRecentRTT());
+  Serial.print(F(" loss="));
+  Serial.print(trend.getRecentLoss());
+  Serial.print(F(" deg="));
+  Serial.print(trend.isDegraded() ? 1 : 0);
+
+  Serial.print(F(" led="));
+  Serial.print(statusLEDMode);
+  Serial.print(F(" rly="));
+  Serial.print(relayMode);
+  Serial.print(F(" sim="));
+  Serial.print(fault.getScenario());
+  Serial.print(F(" dhcp="));
+  Serial.print(USE_DHCP && dhcp.isFromDHCP() ? 1 : 0);
+  Serial.print(F(" ip="));
+  Serial.print(Ethernet.localIP());
+
+  Serial.print(F(" poll="));
+  Serial.print(NTP_SERVER_POLL_TIME);
+  Serial.print(F(" phimax="));
+  Serial.print(PHI_THRESHOLD, 1);
+  Serial.print(F(" maxrty="));
+  Serial.print(MAX_RETRIES);
+  Serial.print(F(" arb="));
+  Serial.print(MODEM_ARBITRATION_TIME);
+
+  if (outageCount > 0) {
+    Serial.print(F(" out="));
+    ind = m.findRecordInProgress();
+    if (ind >= 0)
+      ind = m.getIndexOfPrevCompletedRecord(ind);
+    for (i = 0; (i < outageCount) && (ind != -1); i++) {
+      m.getRecordAt(ind, &mRec);
+      if (i > 0)
+        Serial.print(F(","));
+      Serial.print(mRec.secsSince1900);
+      Serial.print(F(":"));
+      Serial.print(mRec.downMins);
+      ind = m.getIndexOfPrevCompletedRecord(ind);
+    };
+  };
+  Serial.print(F("\r\n"));
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Renew or confirm the DHCP lease if it is due.  If the ethernet shield had to
+// be reconfigured, its sockets are reopened and the lease is cached for the 
+// next power up.  Only the first of a run of unanswered attempts goes in the 
+// journal, since they are retried all through an outage.
+//
+void serviceLease() {
+  static bool journalled = false; // true once an unanswered attempt has been journalled
+  struct lease_t lease;
+  IPAddress dnsIP;
+
+  if (dhcp.maintain() != LEASE_CHANGED)
+    return;
+
+  dnsIP = Ethernet.dnsServerIP();
+  NTP.begin(&dnsIP);
+  if (dhcp.isFromDHCP() || !journalled)
+    journal.log(EV_DHCP, dhcp.isFromDHCP());
+  if (!dhcp.isFromDHCP())
+    counters.dhcpFailures++;
+  journalled = !dhcp.isFromDHCP();
+
+  if (dhcp.isFromDHCP()) {
+    dhcp.getLease(&lease);
+    m.setCachedLease((uint8_t *)&lease, sizeof(lease));
+  };
+
+  if (verboseMode == true) {
+    Serial.print(F("Network settings "));
+    Serial.print(dhcp.isFromDHCP() ? F("from DHCP") : F("kept (no answer from DHCP)"));
+    Serial.print(F(": IP "));
+    Serial.print(Ethernet.localIP());
+    Serial.print(F(", gateway "));
+    Serial.print(Ethernet.gatewayIP());
+    Serial.print(F(", DNS "));
+    Serial.print(Ethernet.dnsServerIP());
+    Serial.print(F("\r\n"));
   };
   return;
 };
@@ -679,22 +1466,56 @@ void switchRelayOff() {
 
 //
 //-----------------------------------------------------------------------------
-// Send record presently indexed out through serial port
+// Remove power from the modem (ie energise the relay to open the N/C contacts)
+// and start TIMER2 timing MODEM_POWER_OFF_TIME.  The relay is left alone if it
+// has been forced off.
+//
+void startRelayPulse() {
+  TIMSK2 &= ~B00000010;  // Disable Timer COMPA Interrupt while the count is set up
+  if (relayMode != OUTPUT_OFF)
+    digitalWrite(relayPin, HIGH);
+
+  relayTicks = MODEM_POWER_OFF_TIME / RELAY_TICK_TIME;
+  relayPulseDone = false;
+  TCNT2 = 0;
+  TIFR2 = B00000010;     // Clear any pending compare match, so the first tick is a full 4ms
+  TIMSK2 |= B00000010;   // Enable Timer COMPA Interrupt
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Send the time of the record at the passed EEPROM index out through serial
+// port.  dumpOutageDuration() finishes the line.
 // Serial port must have already been initialised
 //
-void dumpOutageRecord() {
+void dumpOutageTime(int ind) {
   struct modemRecord_t mRec;
-  NTPClass n;
+  struct NTPTime_t savedTime;
 
-  m.getDataFromIndex();
-  m.convertFromEEPROMBlock(&mRec);
+  m.getRecordAt(ind, &mRec);
 
   Serial.print(F("    "));
 
-  // Use the methods in the NTPClass to convert secsSince1900 into meaningful text and print it out
-  n.t.secsSince1900 = mRec.secsSince1900;
-  n.getYMDHMS();
-  n.printTimeDateInfo();
+  // Use the methods in the NTPClass to convert secsSince1900 into meaningful text and print it out. The 
+  // present time is put back afterwards (a second NTPClass would cost a lot of stack)
+  savedTime = NTP.t;
+  NTP.t.secsSince1900 = mRec.secsSince1900;
+  NTP.getYMDHMS();
+  NTP.printTimeDateInfo();
+  NTP.t = savedTime;
+
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Send the rest of the line started by dumpOutageTime()
+//
+void dumpOutageDuration(int ind) {
+  struct modemRecord_t mRec;
+
+  m.getRecordAt(ind, &mRec);
 
   *buffer = '\0';
   Serial.print(F(", modem went offline"));
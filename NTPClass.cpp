@@ -7,6 +7,19 @@
 //  Revision History
 //  ~~~~~~~~~~~~~~~~
 //    2 Dec 2024 MDS Original
+//    18 Oct 2026 MDS Server selection by remembered health
+//    18 Oct 2026 MDS Cached server addresses and shorter W5100 retransmission
+//    18 Oct 2026 MDS Kiss-o'-Death handling and per server poll intervals
+//    18 Oct 2026 MDS Time only accepted when it agrees with the other servers
+//    18 Oct 2026 MDS Simulated DNS failure for fault injection
+//    18 Oct 2026 MDS Failover skips every server that has failed since the last reply
+//    18 Oct 2026 MDS RTT of the last reply kept in full
+//    18 Oct 2026 MDS Replies only used if they echo our transmit timestamp
+//    18 Oct 2026 MDS First time after power up held until a second server agrees
+//    18 Oct 2026 MDS Simulated reply loss for fault injection
+//    18 Oct 2026 MDS Unused time of the last failure no longer kept with the server health
+//    18 Oct 2026 MDS Simulated link failure, paced like a real one
+//    18 Oct 2026 MDS Cached server addresses kept through a simulated DNS failure
 //
 //------------------------------------------------------------------------------
 
@@ -19,6 +32,12 @@
 // Constructor 
 NTPClass::NTPClass() {
   t.secsSince1900 = 0;
+  for (uint8_t i = 0; i < NUM_NTP_SERVERS; i++) {
+    health[i].score = HEALTH_SCORE_INITIAL;
+    health[i].rtt = 0;
+    _serverIP[i] = 0;
+    _pollExp[i] = NTP_MIN_POLL_EXP;
+  };
   return;
 };
 
@@ -28,6 +47,13 @@ NTPClass::NTPClass() {
 void NTPClass::begin(IPAddress *dnsIP) {
   Udp.begin(LOCAL_PORT);
   dnsC.begin(*dnsIP);
+
+  // The socket buffer partition (2KB per socket) and SPI clock are compiled into V1.1.2 of the 
+  // Ethernet library, so the retransmission timing is the part of the chip set up that we can tune
+  SPI.beginTransaction(SPI_ETHERNET_SETTINGS);
+  W5100.setRetransmissionTime(RETRANSMISSION_TIME);
+  W5100.setRetransmissionCount(RETRANSMISSION_COUNT);
+  SPI.endTransaction();
 };
 
 //
@@ -36,17 +62,32 @@ void NTPClass::begin(IPAddress *dnsIP) {
 // NTPServer array, and modifies the local day, month, year,
 // day of week if successful.
 //
+// Servers are only polled as often as they allow - if the present server 
+// can't be polled yet, we poll the healthiest server that can.
+//
 // Returns:
 //   0 on success
 //  -1 on failure
+//   1 if the server replied with a Kiss-o'-Death (it is reachable, but gave 
+//     us no time).  The code is available from getKissCode()
+//   2 if no server may be polled yet (nothing was sent)
+//   3 if the server's time disagrees with the other servers (it is reachable,
+//     but the time has been ignored)
+//   4 if we have no time yet and no other server has confirmed this one (it is
+//     reachable, and its time is kept for the next server to confirm)
 int NTPClass::getNTPTime() {
   uint8_t buffer[30];
 
+  if (!selectPollableServer())
+    return 2;
+
   strcpy_P(buffer, NTPServer[NTPSrv]);
   while (Udp.parsePacket() > 0) // Discard previously received packets
     ;
 
   if (sendNTPPacket(buffer) == 0) { // send an NTP packet to a time server
+    _sentMillis[NTPSrv] = millis();
+    _sentMask |= (1 << NTPSrv);
 
 #ifdef VERBOSE_MODE
   Serial.print(F("Contacting "));
@@ -55,6 +96,7 @@ int NTPClass::getNTPTime() {
 #endif
 
     uint32_t beginWait = millis();
+    uint32_t rtt;
     while ((millis() - beginWait) < NTP_SERVER_RESPONSE_TIME) { // Wait for a response
       if (Udp.parsePacket() >= NTP_PACKET_SIZE) {
         byte packetBuffer[NTP_PACKET_SIZE]; //buffer to hold incoming and outgoing packets
@@ -62,16 +104,96 @@ int NTPClass::getNTPTime() {
         // We've received a packet, read the data from it
         Udp.read(packetBuffer, NTP_PACKET_SIZE); // read the packet into the buffer
 
+        // As per RFC 5905, only a server mode reply that echoes our transmit timestamp is an answer to 
+        // this request.  Anything else is stale or spoofed, and mustn't get near the Kiss-o'-Death back 
+        // off or the time, so we keep waiting
+        if (((packetBuffer[0] & 0x07) != 4) || (memcmp(&packetBuffer[24], _xmtStamp, 8) != 0))
+          continue;
+
+        // Simulated loss throws the reply away as if it never arrived, so it fails like a real one
+        if ((_replyLoss > 0) && (random(100) < _replyLoss))
+          continue;
+
+        // Stratum 0 is a Kiss-o'-Death, with a four character code in place of the reference ID
+        if (packetBuffer[1] == 0) {
+          memcpy(_kissCode, &packetBuffer[12], 4);
+          _kissCode[4] = '\0';
+
+          if ((strcmp_P(_kissCode, PSTR("DENY")) == 0) || (strcmp_P(_kissCode, PSTR("RSTR")) == 0)) {
+            _pollExp[NTPSrv] = NTP_DENY_POLL_EXP;
+            health[NTPSrv].score = 0;
+          } else if (strcmp_P(_kissCode, PSTR("RATE")) == 0) {
+            _pollExp[NTPSrv] = _pollExp[NTPSrv] + 1 < NTP_RATE_POLL_EXP ? NTP_RATE_POLL_EXP : _pollExp[NTPSrv] + 1;
+            if (_pollExp[NTPSrv] > NTP_MAX_POLL_EXP)
+              _pollExp[NTPSrv] = NTP_MAX_POLL_EXP;
+          };
+
+          selectServer(NTPSrv);
+          return 1;
+        };
+
         // The timestamp starts at byte 40 of the received packet and is four bytes.
         // Combine the four bytes into a long integer. This is NTP time (seconds since Jan 1 1900):
-        t.secsSince1900 = (uint32_t)packetBuffer[40];
-        t.secsSince1900 = (t.secsSince1900 << 8)| (uint32_t)packetBuffer[41];
-        t.secsSince1900 = (t.secsSince1900 << 8)| (uint32_t)packetBuffer[42];
-        t.secsSince1900 = (t.secsSince1900 << 8)| (uint32_t)packetBuffer[43];
-
-        t.secsSince1900 += (HOURS_OFFSET_FROM_UTC * 3600);
+        uint32_t secs, now = millis();
+        secs = (uint32_t)packetBuffer[40];
+        secs = (secs << 8)| (uint32_t)packetBuffer[41];
+        secs = (secs << 8)| (uint32_t)packetBuffer[42];
+        secs = (secs << 8)| (uint32_t)packetBuffer[43];
+
+        // Check the time against the other servers before we use it.  Its time is kept either way, so 
+        // that a good server can be outvoted by a bad one at most until a second good server replies
+        bool accepted = isConsensus(secs, now);
+        bool provisional = !accepted && (_syncSecs == 0) && (secs >= EARLIEST_VALID_TIME);
+        for (uint8_t i = 0; i < NUM_NTP_SERVERS; i++)
+          if ((i != NTPSrv) && isFreshSample(i, now))
+            provisional = false;
+        _sampleSecs[NTPSrv] = secs;
+        _sampleMillis[NTPSrv] = now;
+        _sampleMask |= (1 << NTPSrv);
+
+        if (!accepted) {
+          selectServer(NTPSrv);
+          return provisional ? 4 : 3;
+        };
+
+        t.secsSince1900 = secs + (HOURS_OFFSET_FROM_UTC * 3600);
         getYMDHMS(true);
 
+        _syncSecs = t.secsSince1900;
+        _syncMillis = now;
+
+        // A short run of failures that ended with this server answering was down to the servers that failed
+        if (_failuresSinceReply <= MAX_BLAMED_FAILURES) {
+          for (uint8_t i = 0; i < NUM_NTP_SERVERS; i++)
+            if (_failedSince & (1 << i))
+              health[i].score -= health[i].score / 4;
+        };
+        _failedSince = 0;
+        _failuresSinceReply = 0;
+
+        rtt = _syncMillis - beginWait;
+        health[NTPSrv].rtt = rtt > 255 ? 255 : rtt;
+        _lastRTT = rtt;
+        health[NTPSrv].score += (255 - health[NTPSrv].score) / 8;
+
+        // The server is happy with how often we are polling it, so ease off any back off
+        if (_pollExp[NTPSrv] >= NTP_DENY_POLL_EXP)
+          _pollExp[NTPSrv] = NTP_MIN_POLL_EXP;
+        else if (_pollExp[NTPSrv] > NTP_MIN_POLL_EXP)
+          _pollExp[NTPSrv]--;
+
+        // If we don't have recent times from enough servers, move the next poll to the healthiest 
+        // server we haven't heard from lately.  This builds up the consensus without any extra polls
+        uint8_t fresh = 0, next = 0xff;
+        for (uint8_t i = 0; i < NUM_NTP_SERVERS; i++) {
+          if (isFreshSample(i, now))
+            fresh++;
+          else if ((health[i].score > 0) && ((next == 0xff) || (health[i].score > health[next].score)))
+            next = i;
+        };
+        if ((fresh < CONSENSUS_SERVERS) && (next != 0xff))
+          NTPSrv = next;
+
         return 0;
       }
     }
@@ -84,10 +206,13 @@ int NTPClass::getNTPTime() {
   Serial.print(F("         \r\n"));
 #endif
 
+  _serverIP[NTPSrv] = 0; // The server may have moved, so look it up again next time
+  _failedSince |= (1 << NTPSrv);
+  if (_failuresSinceReply < 255)
+    _failuresSinceReply++;
+
   // Try a different server
-  NTPSrv++;
-  if (strlen_P(NTPServer[NTPSrv]) == 0)
-    NTPSrv = 0;
+  selectServer(NTPSrv);
 
   return -1;
 } // NTPClass::getNTPTime()
@@ -274,9 +399,20 @@ int NTPClass::sendNTPPacket(char* URL) {
   packetBuffer[14]  = 49;
   packetBuffer[15]  = 52;
 
+  // The transmit timestamp is only there to be echoed back, so we make it hard to guess rather than 
+  // accurate
+  uint32_t stamp = millis();
+  uint32_t nonce = micros();
+  for (uint8_t i = 0; i < 4; i++) {
+    _xmtStamp[i] = stamp >> (24 - 8*i);
+    _xmtStamp[i+4] = nonce >> (24 - 8*i);
+  };
+  memcpy(&packetBuffer[40], _xmtStamp, 8);
+
   // all NTP fields have been given values, now send a packet requesting a timestamp
-  if (dnsC.getHostByName(URL, timeServer)) { 
-    // getHostByName() has a hardcoded timeout time in DNS.cpp of 5000ms and 3 retries hard coded
+  if (resolveServer(URL, timeServer) == 0) { 
+    if (_linkFault) // With the link down the request would go nowhere, so don't send it
+      return 0;
     Udp.beginPacket(timeServer, 123); //NTP requests are to port 123
     Udp.write(packetBuffer, NTP_PACKET_SIZE);
     Udp.endPacket();
@@ -291,6 +427,34 @@ int NTPClass::sendNTPPacket(char* URL) {
   return -1;
 } // sendNTPPacket(char* URL)
 
+//
+//-----------------------------------------------------------------------------
+// Get the IP address of the present server, which must be the passed URL.
+// The cached address is used if we have one, otherwise we use the DNS Client 
+// library to look it up.
+//
+// Returns:
+//   0 on success
+//  -1 on failure
+int NTPClass::resolveServer(char* URL, IPAddress &ip) {
+
+  if ((_serverIP[NTPSrv] != 0) && (millis() - _resolvedMillis[NTPSrv] < DNS_CACHE_TIME)) {
+    ip = IPAddress(_serverIP[NTPSrv]);
+    return 0;
+  };
+
+  if (_dnsFault || _linkFault)
+    return -1;
+
+  // getHostByName() has a hardcoded timeout time in DNS.cpp of 5000ms and 3 retries hard coded
+  if (dnsC.getHostByName(URL, ip) != 1)
+    return -1;
+
+  _serverIP[NTPSrv] = (uint32_t)ip;
+  _resolvedMillis[NTPSrv] = millis();
+  return 0;
+} // resolveServer(char* URL, IPAddress &ip)
+
 //
 //-----------------------------------------------------------------------------
 // Adjusts the passed UNIX time (seconds since 1 Jan 1970) for daylight savings 
@@ -350,6 +514,198 @@ void NTPClass::getPresentServer(uint8_t *b) {
   strcpy_P(b, NTPServer[NTPSrv]);
 }
 
+//
+//-----------------------------------------------------------------------------
+// Point at the healthiest server, other than the passed one (pass 0xff to
+// consider all servers) and any that have failed since the last reply.  
+// Servers which may be polled now are preferred over those still waiting out
+// their poll interval.  Ties go to the quickest server, then to the first in
+// the list.
+//
+// Once every server has failed, their scores no longer mean anything, so we
+// go round the list in turn until one of them answers.
+//
+void NTPClass::selectServer(uint8_t exclude) {
+  uint8_t best = 0xff;
+  bool bestAllowed = false, allowed;
+
+  for (uint8_t i = 0; i < NUM_NTP_SERVERS; i++) {
+    if ((i == exclude) || (_failedSince & (1 << i)))
+      continue;
+    allowed = isPollAllowed(i);
+    if ((best == 0xff) ||
+        (allowed && !bestAllowed) ||
+        ((allowed == bestAllowed) && 
+          ((health[i].score > health[best].score) ||
+          ((health[i].score == health[best].score) && (health[i].rtt < health[best].rtt))))) {
+      best = i;
+      bestAllowed = allowed;
+    };
+  };
+
+  if (best != 0xff)
+    NTPSrv = best;
+  else
+    NTPSrv = (NTPSrv + 1) % NUM_NTP_SERVERS;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns true if we have a time from the passed server that is recent 
+// enough to check other servers against at the passed millis() time
+//
+bool NTPClass::isFreshSample(uint8_t srv, uint32_t now) {
+  return ((_sampleMask & (1 << srv)) != 0) && (now - _sampleMillis[srv] < CONSENSUS_MAX_AGE);
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns true if the time from the passed server, projected forward to the 
+// passed millis() time, agrees with the passed time (seconds since 1900, UTC)
+//
+bool NTPClass::samplesAgree(uint8_t srv, uint32_t now, uint32_t secs, uint32_t tolerance) {
+  uint32_t age = now - _sampleMillis[srv];
+  uint32_t projected = _sampleSecs[srv] + age / 1000;
+
+  tolerance += age / 200000; // 0.5% drift, in seconds
+  return (secs > projected ? secs - projected : projected - secs) <= tolerance;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Decide whether the passed time (seconds since 1900, UTC) received from the
+// present server at the passed millis() time should be used.  This is a 
+// cheap majority vote: each recent time from another server is supported by
+// the times that agree with it, and the new time is accepted if it has at
+// least as much support as any of the times which disagree with it (ties 
+// with no support go to the times we already have, since one of them set 
+// our clock).  With no recent times from other servers, we can only check
+// that the time is sensible - and until our clock has been set, not even
+// that is enough, so that a single falseticker at power up can't seed the 
+// outage log and the journal.
+//
+bool NTPClass::isConsensus(uint32_t secs, uint32_t now) {
+  uint8_t support = 0, rivalSupport = 0, rivals = 0, s;
+
+  if (secs < EARLIEST_VALID_TIME)
+    return false;
+
+  for (uint8_t i = 0; i < NUM_NTP_SERVERS; i++) {
+    if ((i == NTPSrv) || !isFreshSample(i, now))
+      continue;
+
+    if (samplesAgree(i, now, secs, CONSENSUS_TOLERANCE)) {
+      support++;
+      continue;
+    };
+
+    // This server disagrees, so count its own support (including from this server's previous time)
+    rivals++;
+    s = 0;
+    for (uint8_t j = 0; j < NUM_NTP_SERVERS; j++) {
+      if ((j == i) || !isFreshSample(j, now))
+        continue;
+      if (samplesAgree(j, now, _sampleSecs[i] + (now - _sampleMillis[i]) / 1000, 
+          CONSENSUS_TOLERANCE + (now - _sampleMillis[i]) / 200000))
+        s++;
+    };
+    if (s > rivalSupport)
+      rivalSupport = s;
+  };
+
+  if (rivals == 0)
+    return (support > 0) || (_syncSecs != 0);
+  if (support == 0)
+    return false;
+  return support >= rivalSupport;
+};
+
+//
+//-----------------------------------------------------------------------------
+// If the present server's poll interval hasn't passed yet, point at the 
+// healthiest server which can be polled.  Returns false if no server can be
+// polled yet.
+//
+bool NTPClass::selectPollableServer() {
+  if (!isPollAllowed(NTPSrv))
+    selectServer(0xff);
+  return isPollAllowed(NTPSrv);
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns true if the passed server's poll interval has passed since we last
+// sent it a request
+//
+bool NTPClass::isPollAllowed(uint8_t srv) {
+  if ((_sentMask & (1 << srv)) == 0)
+    return true;
+  return (millis() - _sentMillis[srv]) >= (1000UL << _pollExp[srv]);
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getter for the code from the last Kiss-o'-Death (eg RATE, DENY)
+//
+void NTPClass::getKissCode(char *b) {
+  strcpy(b, _kissCode);
+};
+
+
+//
+//-----------------------------------------------------------------------------
+// Pass true to make every DNS lookup fail straight away, as if the DNS server
+// had gone down.  The cached server addresses are kept, so this shows whether
+// the servers we have addresses for carry us through a DNS outage.
+//
+void NTPClass::setDNSFault(bool fault) {
+  _dnsFault = fault;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Set the percentage of replies to throw away, as if they had been lost on 
+// the way back.  This is done before a reply counts for anything, so the 
+// server health and failover see the loss as they would a real one.
+//
+void NTPClass::setReplyLoss(uint8_t percent) {
+  _replyLoss = percent;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Pass true to simulate the link being down.  Polls go through the normal 
+// server selection and pacing, and a server whose address is cached waits 
+// out the response time as it would for a real request, but nothing is sent.
+// Lookups of the other servers fail straight away.
+//
+void NTPClass::setLinkFault(bool fault) {
+  _linkFault = fault;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getter for the round trip time in ms of the last reply.  This is taken as it
+// comes in, since a reply can move us on to another server
+//
+uint16_t NTPClass::getRTT() {
+  return _lastRTT;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns the present time in seconds since 1900, estimated from the last
+// reply and millis() since then.  Returns 0 if we haven't had a reply yet.
+//
+uint32_t NTPClass::getSecsSince1900() {
+  if (_syncSecs == 0)
+    return 0;
+  return _syncSecs + (millis() - _syncMillis) / 1000;
+};
+
 //
 //-----------------------------------------------------------------------------
 // Display the time date structure info from any valid NTPTime_t structure on 
@@ -7,6 +7,18 @@
 //  Revision History
 //  ~~~~~~~~~~~~~~~~
 //    2 Dec 2024 MDS Original
+//    18 Oct 2026 MDS Server selection by remembered health
+//    18 Oct 2026 MDS Cached server addresses and shorter W5100 retransmission
+//    18 Oct 2026 MDS Kiss-o'-Death handling and per server poll intervals
+//    18 Oct 2026 MDS Time only accepted when it agrees with the other servers
+//    18 Oct 2026 MDS Simulated DNS failure for fault injection
+//    18 Oct 2026 MDS RTT of the last reply kept in full
+//    18 Oct 2026 MDS Replies only used if they echo our transmit timestamp
+//    18 Oct 2026 MDS First time after power up held until a second server agrees
+//    18 Oct 2026 MDS Simulated reply loss for fault injection
+//    18 Oct 2026 MDS Unused time of the last failure no longer kept with the server health
+//    18 Oct 2026 MDS Simulated link failure, paced like a real one
+//    18 Oct 2026 MDS Cached server addresses kept through a simulated DNS failure
 //
 //------------------------------------------------------------------------------
 
@@ -20,6 +32,7 @@
 #include <Ethernet.h>
 #include <EthernetUdp.h>
 #include <Dns.h>
+#include <utility/w5100.h>
 
 struct NTPTime_t {
     uint32_t secsSince1900; // Seconds since 1/1/1900.  This will rollover in 2036
@@ -36,6 +49,15 @@ const char NTPServer[][20] PROGMEM = {
   "pool.ntp.org",   "time.google.com", "time.cloudflare.com", "time.facebook.com", "time.windows.com",   
   "time.apple.com", "ntp.time.in.ua",  "time.nist.gov",       ""
 };
+#define NUM_NTP_SERVERS (sizeof(NTPServer)/sizeof(NTPServer[0]) - 1)
+
+// Health of each NTP server.  This is saved to EEPROM so that after a restart
+// we go straight to a server that has been answering, rather than relearning
+// which servers are slow or dead through failed polls
+struct targetHealth_t {
+    uint8_t  score;          // 0 (never answers) to 255 (always answers)
+    uint8_t  rtt;            // Round trip time of the last reply in ms, capped at 255
+};
 
 const char dayName[][4]   PROGMEM = {
   "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", ""
@@ -59,11 +81,72 @@ class NTPClass {
 
     const int NTP_SERVER_RESPONSE_TIME = 200;      // Maximum time to wait for NTP server response in ms
 
+    // Each DNS lookup moves a query and a 100+ byte reply across the SPI bus (a byte at a time with the
+    // V1.1.2 library) and waits on the DNS server, so server addresses are cached between polls
+    const uint32_t DNS_CACHE_TIME = 6UL*60*60*1000; // Time in ms before a cached server address is looked up again
+
+    // The W5100 retries ARP for every UDP send.  With the modem powered down the defaults (200ms x 8
+    // retries) stall each NTP and DNS send for 1.8s, so we give up sooner
+    const uint16_t RETRANSMISSION_TIME = 2000;     // 100us units, ie 200ms
+    const uint8_t  RETRANSMISSION_COUNT = 2;
+
+    uint32_t _serverIP[NUM_NTP_SERVERS];           // Cached server addresses, 0 if not looked up
+    uint32_t _resolvedMillis[NUM_NTP_SERVERS];     // millis() when each address was looked up
+
+    // Each server is polled no more often than every 2^_pollExp[] seconds.  A RATE Kiss-o'-Death doubles
+    // the server's interval, and DENY or RSTR (the server wants nothing more to do with us) stops us
+    // using it for 2^NTP_DENY_POLL_EXP seconds (36 hours).  Every reply brings the interval back down.
+    const uint8_t NTP_MIN_POLL_EXP = 4;            // 16s, as per MINPOLL in RFC 5905
+    const uint8_t NTP_RATE_POLL_EXP = 6;           // At least 64s after a RATE Kiss-o'-Death
+    const uint8_t NTP_MAX_POLL_EXP = 12;           // RATE back off goes no further than 68 minutes
+    const uint8_t NTP_DENY_POLL_EXP = 17;
+
+    uint8_t  _pollExp[NUM_NTP_SERVERS];
+    uint32_t _sentMillis[NUM_NTP_SERVERS];         // millis() when we last sent each server a request
+    uint16_t _sentMask = 0;                        // Bit mask of the servers we have sent a request to
+    char     _kissCode[5] = "";                    // Code from the last Kiss-o'-Death
+    uint8_t  _xmtStamp[8];                         // Transmit timestamp of our last request, which a genuine
+                                                   // reply echoes back as its origin timestamp
+
+    bool isPollAllowed(uint8_t);
+
+    // The latest time from each server is kept, and a reply is only used to set the time if at least as
+    // many of the other servers agree with it as agree with any server that disagrees with it.  The 
+    // other servers' times are projected forward with millis(), whose resonator can drift by 0.5%.
+    const uint32_t CONSENSUS_MAX_AGE = 6UL*60*60*1000;  // Time in ms after which a server's time is too old to use
+    const uint32_t CONSENSUS_TOLERANCE = 2;              // Seconds by which servers can differ and still agree,
+                                                         // on top of the drift since the older time
+    const uint8_t  CONSENSUS_SERVERS = 3;                // Number of servers we like to have recent times from
+    const uint32_t EARLIEST_VALID_TIME = 3913056000UL;   // 1/1/2024 in seconds since 1900 - anything earlier is wrong
+
+    uint32_t _sampleSecs[NUM_NTP_SERVERS];               // Latest time (UTC) from each server
+    uint32_t _sampleMillis[NUM_NTP_SERVERS];             // millis() when it was received
+    uint16_t _sampleMask = 0;                            // Bit mask of the servers we have a time from
+
+    bool isFreshSample(uint8_t, uint32_t);
+    bool samplesAgree(uint8_t, uint32_t, uint32_t, uint32_t);
+    bool isConsensus(uint32_t, uint32_t);
+
+    const uint8_t HEALTH_SCORE_INITIAL = 128;      // Score given to a server we know nothing about
+    const uint8_t MAX_BLAMED_FAILURES = 2;         // A failure is only held against a server if another server
+                                                   // answers within this many polls - longer runs of failures
+                                                   // are the link's fault, not the server's
+
+    uint16_t _failedSince = 0;       // Bit mask of the servers which have failed since the last reply
+    uint8_t  _failuresSinceReply = 0;
+    uint32_t _syncSecs = 0;          // secsSince1900 from the last reply (0 if we haven't had one)
+    uint32_t _syncMillis;            // millis() at the last reply
+    uint16_t _lastRTT = 0;           // RTT in ms of the last reply (health[].rtt is capped at 255)
+    bool     _dnsFault = false;      // true while DNS failure is being simulated
+    uint8_t  _replyLoss = 0;         // Percentage of replies thrown away while loss is being simulated
+    bool     _linkFault = false;     // true while the link is simulated down
+
     DNSClient dnsC;
 
     void getYMD();
     int adjustForDST();
     int sendNTPPacket(char*);
+    int resolveServer(char*, IPAddress &);
     void getYMDHMS(bool);
 
 
@@ -72,6 +155,7 @@ class NTPClass {
     // A UDP instance to let us send and receive packets over UDP.  Ethernet connection already needs to be established
     EthernetUDP Udp;
     struct NTPTime_t t;
+    struct targetHealth_t health[NUM_NTP_SERVERS];
 
     NTPClass();
     void begin(IPAddress *);
@@ -79,6 +163,14 @@ class NTPClass {
     int getNTPTime();
     void getYMDHMS();
     void getPresentServer(uint8_t*);
+    void selectServer(uint8_t);
+    bool selectPollableServer();
+    uint16_t getRTT();
+    void getKissCode(char*);
+    uint32_t getSecsSince1900();
+    void setDNSFault(bool);
+    void setReplyLoss(uint8_t);
+    void setLinkFault(bool);
     void printTimeDateInfo();
   
 }; // class NTPClass
@@ -0,0 +1,152 @@
+//
+// ProbeHistoryClass.cpp
+//
+// Contains the methods for the ProbeHistoryClass, which keeps the outcome of
+// the last 512 NTP polls and draws them out through the serial port.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS RTTs over 255ms
+//
+//------------------------------------------------------------------------------
+#include "ProbeHistoryClass.h"
+
+// Characters for the sparklines.  Loss is drawn a byte (8 probes) per 
+// character, indexed by the number of probes lost.  RTT is drawn 4 probes 
+// per character, indexed by the slowest RTT class among the replies, or '!'
+// if none of the 4 were answered
+const char lossChars[] PROGMEM = "_.:-=+*#@";
+const char rttChars[] PROGMEM = "_-=^";
+
+//
+//-----------------------------------------------------------------------------
+// Constructor
+ProbeHistoryClass::ProbeHistoryClass() {
+  _next = 0;
+  _count = 0;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Record a probe - pass true and the RTT in ms if it was answered, otherwise
+// false
+//
+void ProbeHistoryClass::add(bool replied, uint16_t rtt) {
+  uint8_t cls = 0;
+  uint8_t shift = (_next % 4) * 2;
+
+  if (replied)
+    _outcomes[_next / 8] |= (1 << (_next % 8));
+  else
+    _outcomes[_next / 8] &= ~(1 << (_next % 8));
+
+  if (rtt >= RTT_CLASS_3)
+    cls = 3;
+  else if (rtt >= RTT_CLASS_2)
+    cls = 2;
+  else if (rtt >= RTT_CLASS_1)
+    cls = 1;
+  _rttClass[(_next % PROBE_RTT_LENGTH) / 4] = (_rttClass[(_next % PROBE_RTT_LENGTH) / 4] & ~(3 << shift)) | (cls << shift);
+
+  _next = (_next + 1) % PROBE_HISTORY_LENGTH;
+  if (_count < PROBE_HISTORY_LENGTH)
+    _count++;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getter for the number of probes remembered
+//
+uint16_t ProbeHistoryClass::getCount() {
+  return _count;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns how many of the last n probes were answered.  The span is counted a
+// byte at a time, masking off the probes outside it in the first and last 
+// bytes
+//
+uint16_t ProbeHistoryClass::getReplies(uint16_t n) {
+  uint16_t pos, replies = 0;
+  uint8_t bit, take;
+
+  if (n > _count)
+    n = _count;
+  pos = (_next + PROBE_HISTORY_LENGTH - n) % PROBE_HISTORY_LENGTH;
+
+  while (n > 0) {
+    bit = pos % 8;
+    take = 8 - bit;
+    if (take > n)
+      take = n;
+    replies += __builtin_popcount(_outcomes[pos / 8] & (uint8_t)(((1 << take) - 1) << bit));
+    pos = (pos + take) % PROBE_HISTORY_LENGTH;   // PROBE_HISTORY_LENGTH is a multiple of 8, so we never wrap mid byte
+    n -= take;
+  };
+  return replies;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns the percentage of the last n probes that weren't answered
+//
+uint8_t ProbeHistoryClass::getLoss(uint16_t n) {
+  if (n > _count)
+    n = _count;
+  if (n == 0)
+    return 0;
+  return ((uint32_t)(n - getReplies(n)) * 100 + n/2) / n;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Send the loss and RTT sparklines out through the serial port, oldest probe 
+// on the left.  Only whole characters are drawn, so the newest few probes may
+// not show until the character is complete
+//
+void ProbeHistoryClass::printSparklines() {
+  uint16_t pos, i, n;
+  uint8_t j, cls, worst;
+  bool anyReply;
+
+  // Loss, 8 probes to a character, ending at the last whole byte
+  n = ((_count - _next % 8) / 8) * 8;
+  pos = (_next - _next % 8 + PROBE_HISTORY_LENGTH - n) % PROBE_HISTORY_LENGTH;
+  Serial.print(F("  Loss "));
+  for (i = 0; i < n; i += 8) {
+    Serial.print((char)pgm_read_byte(&lossChars[8 - __builtin_popcount(_outcomes[pos / 8])]));
+    pos = (pos + 8) % PROBE_HISTORY_LENGTH;
+  };
+  Serial.print(F("\r\n"));
+
+  // RTT, 4 probes to a character, ending at the last whole group of 4 and going back no further
+  // than the RTT classes we still have
+  n = (_count < PROBE_RTT_LENGTH ? _count : PROBE_RTT_LENGTH);
+  n = ((n - _next % 4) / 4) * 4;
+  pos = (_next - _next % 4 + PROBE_HISTORY_LENGTH - n) % PROBE_HISTORY_LENGTH;
+  Serial.print(F("  RTT  "));
+  for (i = 0; i < n; i += 4) {
+    worst = 0;
+    anyReply = false;
+    for (j = 0; j < 4; j++) {
+      if ((_outcomes[(pos + j) / 8] & (1 << ((pos + j) % 8))) == 0)
+        continue;
+      anyReply = true;
+      cls = (_rttClass[(pos % PROBE_RTT_LENGTH) / 4] >> (j * 2)) & 3;
+      if (cls > worst)
+        worst = cls;
+    };
+    Serial.print(anyReply ? (char)pgm_read_byte(&rttChars[worst]) : '!');
+    pos = (pos + 4) % PROBE_HISTORY_LENGTH;
+  };
+  Serial.print(F("\r\n"));
+  return;
+};
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
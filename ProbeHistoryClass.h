@@ -0,0 +1,51 @@
+//
+// ProbeHistoryClass.h
+//
+// Data definition and function prototype file for ProbeHistoryClass.cpp,
+// which remembers the outcome of the last 512 NTP polls (probes) so that the
+// recent behaviour of the link can be looked at without waiting for an outage
+// to complete
+//
+// Outcomes are packed one bit per probe (1 = reply) into a 64 byte circular
+// list, so that loss over any span can be counted a byte at a time with a
+// popcount.  The RTT of the last 256 probes is kept alongside as a 2 bit class.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS RTTs over 255ms
+//
+//------------------------------------------------------------------------------
+#ifndef __PROBE_HISTORY_CLASS_H
+#define __PROBE_HISTORY_CLASS_H
+
+#include <Arduino.h>
+
+#define PROBE_HISTORY_LENGTH   512     // Probes remembered (a multiple of 8)
+#define PROBE_RTT_LENGTH       256     // Probes whose RTT class is remembered (a multiple of 4)
+
+class ProbeHistoryClass {
+  private:
+    static const uint8_t RTT_CLASS_1 = 20;   // RTTs in ms from which a reply is in class 1, 2 and 3.
+    static const uint8_t RTT_CLASS_2 = 50;   // Class 0 is anything faster than RTT_CLASS_1
+    static const uint8_t RTT_CLASS_3 = 100;
+
+    uint8_t  _outcomes[PROBE_HISTORY_LENGTH / 8];  // Bit n%8 of byte n/8 is probe n, 1 if it was answered
+    uint8_t  _rttClass[PROBE_RTT_LENGTH / 4];      // Bits 2(n%4)+1..2(n%4) of byte n/4 are the RTT class of probe n
+    uint16_t _next;                                // Where the next probe goes in _outcomes[]
+    uint16_t _count;                               // Number of probes remembered, up to PROBE_HISTORY_LENGTH
+
+  public:
+    ProbeHistoryClass();
+    void add(bool, uint16_t);
+    uint16_t getCount();
+    uint16_t getReplies(uint16_t);
+    uint8_t getLoss(uint16_t);
+    void printSparklines();
+}; // class ProbeHistoryClass
+
+#endif
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
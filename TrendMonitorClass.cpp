@@ -0,0 +1,115 @@
+//
+// TrendMonitorClass.cpp
+//
+// Contains the methods for the TrendMonitorClass, which decides whether the
+// link through the modem has degraded enough to warrant a planned restart.
+//
+// All of the averaging is done in fixed point - an EWMA with a weight of
+// 1/2^n is just avg += (sample - avg) >> n.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS RTTs over 255ms
+//
+//------------------------------------------------------------------------------
+#include "TrendMonitorClass.h"
+
+//
+//-----------------------------------------------------------------------------
+// Constructor
+TrendMonitorClass::TrendMonitorClass() {
+  restart();
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Start learning a new baseline.  Called after each modem power cycle, since
+// the whole point of the restart is to get back to a fresh modem's behaviour
+//
+void TrendMonitorClass::restart() {
+  _numPolls = 0;
+  _baselineSum = 0;
+  _baselineRTT = 0;
+  _recentRTT = 0;
+  _recentLoss = 0;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Record a successful poll with the passed round trip time in ms
+//
+void TrendMonitorClass::addSuccess(uint16_t rtt) {
+  int32_t sample;
+
+  if (rtt > MAX_RTT)
+    rtt = MAX_RTT;
+  sample = (int32_t)rtt << 4;
+
+  if (_numPolls < BASELINE_POLLS) {
+    _baselineSum += rtt;
+    _recentRTT = sample; // Start the recent average from the latest poll rather than from zero
+  } else {
+    _recentRTT += (sample - (int32_t)_recentRTT) >> RTT_SHIFT;
+  };
+
+  _recentLoss -= _recentLoss >> LOSS_SHIFT;
+
+  if (_numPolls < BASELINE_POLLS + SETTLE_POLLS) {
+    _numPolls++;
+    if (_numPolls == BASELINE_POLLS)
+      _baselineRTT = _baselineSum / BASELINE_POLLS;
+  };
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Record a failed poll.  Only the scheduled polls should be passed in here, 
+// not the quick retries which follow them - a single blip would otherwise 
+// look like heavy loss
+//
+void TrendMonitorClass::addFailure() {
+  _recentLoss += (0xffff - _recentLoss) >> LOSS_SHIFT;
+  return;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Returns true once the baseline and recent averages are established and the
+// recent RTT or loss have drifted too far from the baseline
+//
+bool TrendMonitorClass::isDegraded() {
+  uint16_t allowedRTT;
+
+  if (_numPolls < BASELINE_POLLS + SETTLE_POLLS)
+    return false;
+
+  allowedRTT = _baselineRTT + (_baselineRTT / 2 > RTT_MARGIN ? _baselineRTT / 2 : RTT_MARGIN);
+  if ((_recentRTT >> 4) > allowedRTT)
+    return true;
+
+  return _recentLoss > LOSS_DEGRADED;
+};
+
+//
+//-----------------------------------------------------------------------------
+// Getters for the diagnostics. RTTs are in ms, loss is in percent
+//
+uint16_t TrendMonitorClass::getBaselineRTT() {
+  return _baselineRTT;
+};
+
+uint16_t TrendMonitorClass::getRecentRTT() {
+  return _recentRTT >> 4;
+};
+
+uint8_t TrendMonitorClass::getRecentLoss() {
+  return ((uint32_t)_recentLoss * 100) >> 16;
+};
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------
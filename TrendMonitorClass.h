@@ -0,0 +1,59 @@
+//
+// TrendMonitorClass.h
+//
+// Data definition and function prototype file for TrendMonitorClass.cpp,
+// which watches the quality of the NTP polls for the slow degradation (RTT
+// creep, rising loss) that our modems show for days before they fail outright
+//
+// A baseline RTT is learnt over the first polls after each modem power cycle,
+// while the modem is fresh.  From then on the recent RTT and poll loss are
+// tracked as exponentially weighted moving averages and compared against it.
+//
+// RTTs of up to 4 seconds can be averaged, but a reply is only waited for for
+// NTPClass's NTP_SERVER_RESPONSE_TIME (200ms).  On a link whose baseline is 
+// over two thirds of that, a rise in RTT shows up as lost polls instead.
+//------------------------------------------------------------------------------
+//  Revision History
+//  ~~~~~~~~~~~~~~~~
+//    18 Oct 2026 MDS Original
+//    18 Oct 2026 MDS RTTs over 255ms
+//
+//------------------------------------------------------------------------------
+#ifndef __TREND_MONITOR_CLASS_H
+#define __TREND_MONITOR_CLASS_H
+
+#include <Arduino.h>
+
+class TrendMonitorClass {
+  private:
+    static const uint16_t BASELINE_POLLS = 180;    // Successful polls to learn the baseline from (2 hours at 40s)
+    static const uint16_t SETTLE_POLLS = 128;      // Further polls before the recent averages are trusted
+    static const uint8_t  RTT_SHIFT = 6;           // Recent RTT averages over about 2^6 polls
+    static const uint8_t  LOSS_SHIFT = 8;          // Recent loss averages over about 2^8 polls
+    static const uint8_t  RTT_MARGIN = 20;         // Minimum RTT rise in ms before we call it degraded,
+                                                   // since a few ms of jitter doubles a small RTT
+    static const uint16_t LOSS_DEGRADED = 3277;    // Recent loss which is degraded, 5% of 65536
+    static const uint16_t MAX_RTT = 4095;          // Longest RTT in ms that fits _recentRTT
+
+    uint16_t _numPolls;        // Successful polls since restart(), stops counting once settled
+    uint32_t _baselineSum;     // Sum of the RTTs while learning the baseline
+    uint16_t _baselineRTT;     // Baseline RTT in ms, valid once _numPolls >= BASELINE_POLLS
+    uint16_t _recentRTT;       // Recent RTT in 1/16ths of a ms
+    uint16_t _recentLoss;      // Recent fraction of polls lost, 65536 == 100%
+
+  public:
+    TrendMonitorClass();
+    void restart();
+    void addSuccess(uint16_t);
+    void addFailure();
+    bool isDegraded();
+    uint16_t getBaselineRTT();
+    uint16_t getRecentRTT();
+    uint8_t getRecentLoss();
+}; // class TrendMonitorClass
+
+#endif
+
+//-----------------------------------------------------------------------------
+// End of file
+//-----------------------------------------------------------------------------